@@ -30,6 +30,8 @@
 #include <pwd.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
 #include <cstring>
 #include <fstream>
 #include <string>
@@ -131,7 +133,12 @@ static bool createJobFile(istream &src, const string &destFile, const Args &args
 {
     Log::debug("Create job file %s", destFile.c_str());
 
-    ofstream dest(destFile, ios::binary | ios::trunc);
+    // The GUI can watch the directory, so it should see only complete files.
+    // We write to the temporary file and rename it when all data is written.
+    string::size_type n = destFile.rfind('/');
+    string tmpFile = destFile.substr(0, n + 1) + "." + destFile.substr(n + 1) + ".part";
+
+    ofstream dest(tmpFile, ios::binary | ios::trunc);
     dest << "\033CUPS_BOOMAGA\n";
     dest << "JOB="     << escapeString(args.jobID)   << "\n";
     dest << "USER="    << escapeString(args.user)    << "\n";
@@ -144,15 +151,23 @@ static bool createJobFile(istream &src, const string &destFile, const Args &args
 
     if (src.bad() || !dest.good())
     {
-        Log::debug("Delete file %s", destFile.c_str());
-        unlink(destFile.c_str());
+        Log::debug("Delete file %s", tmpFile.c_str());
+        unlink(tmpFile.c_str());
         Log::error("Can't create job file: %s", strerror(errno));
         return false;
     }
 
-    if (chown(destFile.c_str(), args.pwd->pw_uid, -1) != 0)
+    if (chown(tmpFile.c_str(), args.pwd->pw_uid, -1) != 0)
+    {
+        Log::error("Can't change owner on directory %s: %s", tmpFile.c_str(), std::strerror(errno));
+        unlink(tmpFile.c_str());
+        return false;
+    }
+
+    if (rename(tmpFile.c_str(), destFile.c_str()) != 0)
     {
-        Log::error("Can't change owner on directory %s: %s", destFile.c_str(), std::strerror(errno));
+        Log::error("Can't rename %s to %s: %s", tmpFile.c_str(), destFile.c_str(), std::strerror(errno));
+        unlink(tmpFile.c_str());
         return false;
     }
 
@@ -160,6 +175,34 @@ static bool createJobFile(istream &src, const string &destFile, const Args &args
 }
 
 
+/************************************************
+ * The running GUI holds the lock on this file while
+ * it watches the spool directory.
+ * The directory belongs to the user and the backend
+ * still runs as root here, so only a regular file
+ * owned by the user is accepted. FIFOs, devices and
+ * symlinks are never opened or block the queue.
+ ************************************************/
+static bool isWatchedByGui(const string &dir, uid_t uid)
+{
+    int fd = open((dir + "/.watcher.lock").c_str(),
+                  O_RDONLY | O_CLOEXEC | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != uid)
+    {
+        close(fd);
+        return false;
+    }
+
+    bool res = flock(fd, LOCK_SH | LOCK_NB) != 0 && errno == EWOULDBLOCK;
+    close(fd);
+    return res;
+}
+
+
 /************************************************
  *
  ************************************************/
@@ -264,6 +307,12 @@ int main(int argc, char *argv[])
 
     return CUPS_BACKEND_OK;
 #else
+    if (isWatchedByGui(dir, args.pwd->pw_uid))
+    {
+        Log::debug("The GUI watches %s, the job file will be picked up by it.", dir.c_str());
+        return CUPS_BACKEND_OK;
+    }
+
     if (setgid(args.pwd->pw_gid) != 0)
         Log::fatalError("Can't change GID to %d: %s.", args.pwd->pw_gid, strerror(errno));
 
@@ -32,6 +32,8 @@
 #include <QDBusConnection>
 #include <QDBusMessage>
 #include <QProcessEnvironment>
+#include <QFileInfo>
+#include <QSet>
 #include <QDebug>
 
 using namespace std;
@@ -81,7 +83,10 @@ void BoomagaDbus::add(const QString &file)
  ************************************************/
 void BoomagaDbus::doAdd(const QString &file)
 {
-    project->load(file);
+    if (receivers(SIGNAL(fileReceived(QString))))
+        emit fileReceived(file);
+    else
+        project->load(file);
 }
 
 
@@ -92,6 +97,12 @@ static bool doRunBoomaga(const QString &dbusAddress, const QList<QVariant> &args
 {
     Log::debug("Try to start boomaga via DBus %s", dbusAddress.toLocal8Bit().data());
     QDBusConnection dbus = QDBusConnection::connectToBus(dbusAddress, "boomaga");
+    // The named connection is reused by connectToBus, so we drop it
+    // to allow the next attempt to connect to another address.
+    struct Disconnect {
+        ~Disconnect() { QDBusConnection::disconnectFromBus("boomaga"); }
+    } disconnect;
+
     if (!dbus.isConnected())
     {
 
@@ -123,7 +134,9 @@ static bool doRunBoomaga(const QString &dbusAddress, const QList<QVariant> &args
 
 
 /************************************************
- *
+ * The cheap sources are tried first, so usually the
+ * job is handed off with a single connect. The full
+ * scan of the user processes is the last resort.
  ************************************************/
 bool BoomagaDbus::runBoomaga(const QString &file)
 {
@@ -137,22 +150,44 @@ bool BoomagaDbus::runBoomaga(const QString &file)
         Log::debug("Start boomaga: %s", s.c_str());
     }
 
-    {
-        QString addr = QProcessEnvironment::systemEnvironment().value("DBUS_SESSION_BUS_ADDRESS");
-        if (!addr.isEmpty() && doRunBoomaga(addr, args))
-            return true;
-    }
+    const QString spoolDir = QFileInfo(file).absolutePath();
+    QSet<QString> tried;
+    auto tryAddress = [&](const QString &addr) -> bool {
+        if (addr.isEmpty() || tried.contains(addr))
+            return false;
+
+        tried << addr;
+        if (!doRunBoomaga(addr, args))
+            return false;
+
+        FindDbusAddress::saveToCache(spoolDir, addr);
+        return true;
+    };
+
+    if (tryAddress(QProcessEnvironment::systemEnvironment().value("DBUS_SESSION_BUS_ADDRESS")))
+        return true;
+
+    if (tryAddress(FindDbusAddress::fromCache(spoolDir)))
+        return true;
+
+    if (tryAddress(FindDbusAddress::fromRuntimeDir()))
+        return true;
+
+#ifdef Q_OS_LINUX
+    if (tryAddress(FindDbusAddress::fromLogind()))
+        return true;
+#endif
 
     foreach (auto &addr, FindDbusAddress::fromSessionFiles())
     {
-        if (doRunBoomaga(addr, args))
+        if (tryAddress(addr))
             return true;
     }
 
 #ifdef Q_OS_LINUX
     foreach (auto &addr, FindDbusAddress::fromProcFiles())
     {
-        if (doRunBoomaga(addr, args))
+        if (tryAddress(addr))
             return true;
     }
 #endif
@@ -160,7 +195,7 @@ bool BoomagaDbus::runBoomaga(const QString &file)
 #ifdef Q_OS_FREEBSD
     foreach (auto &addr, FindDbusAddress::fromProcStat())
     {
-        if (doRunBoomaga(addr, args))
+        if (tryAddress(addr))
             return true;
     }
 #endif
@@ -44,6 +44,9 @@ public slots:
     void add(const QString &file, const QString &title, bool autoRemove, const QString &options = "", uint count = 1);
     void add(const QString &file);
 
+signals:
+    void fileReceived(const QString &file);
+
 private slots:
     void doAdd(const QString &file);
 };
@@ -34,7 +34,16 @@
 #include <unistd.h>
 #include <assert.h>
 #include <QDir>
+#include <QFile>
+#include <QSaveFile>
 #include <QProcess>
+#include <QProcessEnvironment>
+#ifdef Q_OS_LINUX
+#include <QDBusConnection>
+#include <QDBusInterface>
+#include <QDBusReply>
+#include <QDBusObjectPath>
+#endif
 
 
 using namespace std;
@@ -63,6 +72,100 @@ static string readFile(const string &fileName, char delim)
 }
 
 
+static const char * const CACHE_FILE_NAME = ".dbus-address";
+
+
+/************************************************
+ *
+ ************************************************/
+QString FindDbusAddress::fromCache(const QString &spoolDir)
+{
+    QFile file(spoolDir + "/" + CACHE_FILE_NAME);
+    if (!file.open(QFile::ReadOnly))
+        return "";
+
+    return QString::fromLocal8Bit(file.readLine()).trimmed();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void FindDbusAddress::saveToCache(const QString &spoolDir, const QString &address)
+{
+    if (spoolDir.isEmpty() || address == fromCache(spoolDir))
+        return;
+
+    QSaveFile file(spoolDir + "/" + CACHE_FILE_NAME);
+    if (!file.open(QFile::WriteOnly) ||
+        file.write(address.toLocal8Bit() + "\n") < 0 ||
+        !file.setPermissions(QFile::ReadOwner | QFile::WriteOwner) ||
+        !file.commit())
+    {
+        Log::warn("Can't write DBUS address cache %s: %s",
+                  file.fileName().toLocal8Bit().data(),
+                  file.errorString().toLocal8Bit().data());
+    }
+}
+
+
+/************************************************
+ *
+ ************************************************/
+static QString busFromRuntimeDir(const QString &runtimeDir)
+{
+    if (runtimeDir.isEmpty())
+        return "";
+
+    QString socket = runtimeDir + "/bus";
+    struct stat st;
+    if (stat(socket.toLocal8Bit().data(), &st) != 0 || !S_ISSOCK(st.st_mode) || st.st_uid != getuid())
+        return "";
+
+    return "unix:path=" + socket;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QString FindDbusAddress::fromRuntimeDir()
+{
+    QString res = busFromRuntimeDir(QProcessEnvironment::systemEnvironment().value("XDG_RUNTIME_DIR"));
+    if (!res.isEmpty())
+        return res;
+
+    return busFromRuntimeDir(QString("/run/user/%1").arg(getuid()));
+}
+
+
+#ifdef Q_OS_LINUX
+/************************************************
+ *
+ ************************************************/
+QString FindDbusAddress::fromLogind()
+{
+    QDBusInterface manager("org.freedesktop.login1",
+                           "/org/freedesktop/login1",
+                           "org.freedesktop.login1.Manager",
+                           QDBusConnection::systemBus());
+    if (!manager.isValid())
+        return "";
+
+    QDBusReply<QDBusObjectPath> user = manager.call("GetUser", uint(getuid()));
+    if (!user.isValid())
+        return "";
+
+    QDBusInterface userIface("org.freedesktop.login1",
+                             user.value().path(),
+                             "org.freedesktop.login1.User",
+                             QDBusConnection::systemBus());
+
+    return busFromRuntimeDir(userIface.property("RuntimePath").toString());
+}
+#endif
+
+
 /************************************************
  * Looking for DBUS addresses in files in the
  * directory ~/.dbus/session-bus
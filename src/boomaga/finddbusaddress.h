@@ -32,9 +32,21 @@
 class FindDbusAddress
 {
 public:
+   /// Returns the address that was successfully used last time,
+   /// it is stored in the spoolDir.
+   static QString fromCache(const QString &spoolDir);
+   static void saveToCache(const QString &spoolDir, const QString &address);
+
+   /// Returns the address of the per-user bus $XDG_RUNTIME_DIR/bus
+   /// or /run/user/<uid>/bus if the socket exists.
+   static QString fromRuntimeDir();
+
    static QStringList fromSessionFiles();
 
 #ifdef Q_OS_LINUX
+   /// Asks systemd-logind for the runtime directory of the user.
+   static QString fromLogind();
+
    static QStringList fromProcFiles();
 #endif
 
@@ -41,6 +41,9 @@
 #include "printdialog/printdialog.h"
 #include "boomagatypes.h"
 
+#include "iofiles/boofile.h"
+#include "iofiles/blobstore.h"
+
 #ifdef Q_OS_MAC
 #include "updater/updater.h"
 #endif
@@ -59,6 +62,91 @@
 #include <QInputDialog>
 #include <QDateTime>
 #include <QMenu>
+#include <QRunnable>
+
+#define AUTOSAVE_BLOBS_DIR ".blobs"
+
+
+namespace {
+
+/************************************************
+ * The job removes its file when the last copy of the
+ * job is gone. The copies keep the files while the
+ * autosave task reads them. The pages live in the
+ * PageTable, so the copies are released in the GUI
+ * thread.
+ ************************************************/
+class JobsKeeper: public QObject
+{
+public:
+    explicit JobsKeeper(const JobList &jobs):
+        QObject(),
+        mJobs(jobs)
+    {
+    }
+
+private:
+    JobList mJobs;
+};
+
+
+/************************************************
+ * Writes the autosave project in the background, so
+ * printing doesn't wait for the copy of the jobs.
+ ************************************************/
+class AutoSaveTask: public QRunnable
+{
+public:
+    AutoSaveTask(MainWindow *window, const QString &fileName, const QString &blobsDir):
+        mWindow(window),
+        mFileName(fileName),
+        mBlobStore(blobsDir),
+        mMetaData(project->metaData()),
+        mJobs(BooFile::jobRecords(*project->jobs())),
+        mKeeper(new JobsKeeper(*project->jobs()))
+    {
+    }
+
+    void run() override
+    {
+        try
+        {
+            BooFile::save(mFileName, mMetaData, mJobs, &mBlobStore);
+            removeUnreferencedBlobs();
+        }
+        catch (const QString &err)
+        {
+            QFile::remove(mFileName);
+            QMetaObject::invokeMethod(mWindow, "autoSaveFailed",
+                                      Qt::QueuedConnection,
+                                      Q_ARG(QString, err));
+        }
+
+        mKeeper->deleteLater();
+    }
+
+private:
+    /// The user removes the old autosaved projects by hand, the blobs
+    /// that no project refers to anymore are removed after each save.
+    void removeUnreferencedBlobs()
+    {
+        QStringList blobs;
+        QDir dir = QFileInfo(mFileName).dir();
+        foreach (const QFileInfo &fi, dir.entryInfoList(QStringList("*.boo"), QDir::Files))
+            blobs << BooFile::blobFiles(fi.absoluteFilePath());
+
+        mBlobStore.removeUnreferenced(blobs);
+    }
+
+    MainWindow *mWindow;
+    QString mFileName;
+    BlobStore mBlobStore;
+    MetaData mMetaData;
+    QVector<BooFile::JobRecord> mJobs;
+    JobsKeeper *mKeeper;
+};
+
+} // namespace
 
 
 /************************************************
@@ -68,6 +156,7 @@ MainWindow::MainWindow(QWidget *parent):
     QMainWindow(parent),
     ui(new Ui::MainWindow)
 {
+    mAutoSavePool.setMaxThreadCount(1);
     ui->setupUi(this);
     this->setContextMenuPolicy(Qt::NoContextMenu);
     qApp->setAttribute(Qt::AA_DontShowIconsInMenus, true);
@@ -203,6 +292,7 @@ MainWindow::MainWindow(QWidget *parent):
  ************************************************/
 MainWindow::~MainWindow()
 {
+    mAutoSavePool.waitForDone();
     saveSettings();
     delete ui;
 }
@@ -231,6 +321,8 @@ void MainWindow::fillPrintersCombo()
  ************************************************/
 void MainWindow::closeEvent(QCloseEvent*)
 {
+    // The autosave task reads the job files, which are removed by free().
+    mAutoSavePool.waitForDone();
     project->free();
 }
 
@@ -391,6 +483,26 @@ void MainWindow::initActions()
     connect(act, SIGNAL(triggered()),
             this, SLOT(exportAs()));
 
+    // The Edit menus are refilled on every show, so the
+    // window keeps the actions for the shortcuts.
+    act = ui->actionUndo;
+    act->setEnabled(false);
+    addAction(act);
+    connect(act, SIGNAL(triggered()),
+            project, SLOT(undo()));
+
+    act = ui->actionRedo;
+    act->setEnabled(false);
+    addAction(act);
+    connect(act, SIGNAL(triggered()),
+            project, SLOT(redo()));
+
+    connect(project, &Project::historyChanged, [this]()
+    {
+        ui->actionUndo->setEnabled(project->canUndo());
+        ui->actionRedo->setEnabled(project->canRedo());
+    });
+
     act = ui->actionPreferences;
     connect(act, SIGNAL(triggered()),
             this, SLOT(showConfigDialog()));
@@ -870,6 +982,9 @@ void MainWindow::showJobViewContextMenu(const Job &job)
 void MainWindow::showEditPageMainMenu()
 {
     ui->menuEditPage->clear();
+    ui->menuEditPage->addAction(ui->actionUndo);
+    ui->menuEditPage->addAction(ui->actionRedo);
+    ui->menuEditPage->addSeparator();
     fillPageEditMenu(project->currentPage(), ui->menuEditPage);
 }
 
@@ -1164,6 +1279,7 @@ void MainWindow::rotateJobLeft()
         ProjectPage *page = job.page(i);
         page->setManualRotation(page->manualRotation() - Rotate90);
     }
+    project->commitEdit(job);
     project->update();
 }
 
@@ -1183,6 +1299,7 @@ void MainWindow::rotateJobRight()
         ProjectPage *page = job.page(i);
         page->setManualRotation(page->manualRotation() + Rotate90);
     }
+    project->commitEdit(job);
     project->update();
 }
 
@@ -1197,6 +1314,7 @@ void MainWindow::rotatePageLeft()
         return;
 
     act->page()->setManualRotation(act->page()->manualRotation() - Rotate90);
+    project->commitEdit(act->page());
     project->update();
 }
 
@@ -1211,6 +1329,7 @@ void MainWindow::rotatePageRight()
         return;
 
     act->page()->setManualRotation(act->page()->manualRotation() + Rotate90);
+    project->commitEdit(act->page());
     project->update();
 }
 
@@ -1225,6 +1344,7 @@ void MainWindow::startBooklet()
         return;
 
     act->page()->setManualStartSubBooklet(true);
+    project->commitEdit(act->page());
     project->update();
 
     int sheetNum = project->previewSheets().indexOfPage(act->page());
@@ -1243,6 +1363,7 @@ void MainWindow::dontStartBooklet()
         return;
 
     act->page()->setManualStartSubBooklet(false);
+    project->commitEdit(act->page());
     project->update();
 
     int sheetNum = project->previewSheets().indexOfPage(act->page());
@@ -1453,7 +1574,7 @@ void MainWindow::addToRecentFiles(const QString &file)
  ************************************************/
 void MainWindow::saveAuto()
 {
-    if (!settings->value(Settings::AutoSave).toBool())
+    if (!settings->snapshot().autoSave)
             return;
 
     QString dir = settings->value(Settings::AutoSaveDir).toString();
@@ -1476,7 +1597,20 @@ void MainWindow::saveAuto()
 
     file = dir + "/" + file;
     addToRecentFiles(file);
-    project->save(file);
+
+    // The job PDFs go to the shared blob store, the project
+    // file only refers to them.
+    mAutoSavePool.start(new AutoSaveTask(this, file, dir + "/" + AUTOSAVE_BLOBS_DIR));
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void MainWindow::autoSaveFailed(const QString &error)
+{
+    qWarning() << "Auto saving:" << error;
+    QMessageBox::warning(this, tr("Auto saving"), error);
 }
 
 
@@ -31,6 +31,7 @@
 #include <QLabel>
 #include <QProgressBar>
 #include <QMouseEvent>
+#include <QThreadPool>
 #include <kernel/job.h>
 
 class Layout;
@@ -101,6 +102,7 @@ private slots:
     void loadAuto();
 
     void longTaskStarted(const ProjectLongTask *task);
+    void autoSaveFailed(const QString &error);
 
 protected:
     void closeEvent(QCloseEvent *event);
@@ -117,6 +119,7 @@ private:
 
     QProgressBar mProgressBar;
     QString      mSaveFile;
+    QThreadPool  mAutoSavePool;
 
     void fillPrintersCombo();
     void initActions();
@@ -103,7 +103,7 @@ PrinterSettings::PrinterSettings(QWidget *parent) :
     ui->setupUi(this);
     ui->profilesList->setModel(new QStandardItemModel(this));
 
-    if (settings->value(Settings::AllowNegativeMargins).toBool())
+    if (settings->snapshot().allowNegativeMargins)
     {
         ui->leftMarginSpin->setMinimum(-(ui->leftMarginSpin->maximum()));
         ui->rightMarginSpin->setMinimum(-(ui->rightMarginSpin->maximum()));
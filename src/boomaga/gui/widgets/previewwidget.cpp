@@ -41,8 +41,9 @@
 #define MARGIN_BOOKLET  4
 #define RESOLUTIN       150
 
-#define CACHE_PRE       10
-#define CACHE_POST      20
+#define MEMORY_BUDGET   (256 * 1024 * 1024)
+#define MAX_BUDGET      64
+#define MAX_INTERVAL    5000
 
 
 
@@ -51,8 +52,18 @@
  ************************************************/
 RenderCache::RenderCache(double resolution, int threadCount, QObject *parent):
     QObject(parent),
-    mRender(new Render(resolution, threadCount, this))
+    mRender(new Render(resolution, threadCount, this)),
+    mMemoryBudget(MEMORY_BUDGET),
+    mLastReadyTime(0),
+    mReadyInterval(0),
+    mBusy(false),
+    mThreadCount(threadCount)
 {
+    mWindow.first = 0;
+    mWindow.last  = -1;
+    mPolicy.setWorkerCount(threadCount);
+    mClock.start();
+
     connect(mRender, SIGNAL(sheetReady(QImage,int)),
             this, SLOT(onSheetReady(QImage,int)));
 }
@@ -83,43 +94,78 @@ void RenderCache::setFileName(const QString &fileName)
 {
     mRender->setFileName(fileName);
     mItems.clear();
+    mPending.clear();
+    mBusy = false;
 }
 
 
 /************************************************
  *
  ************************************************/
-void RenderCache::renderSheet(int sheetNum)
+void RenderCache::setMemoryBudget(qint64 bytes)
 {
-    if (mItems.contains(sheetNum))
-        emit sheetReady(mItems.value(sheetNum), sheetNum);
-    else
-        mRender->renderSheet(sheetNum);
+    mMemoryBudget = bytes;
+    if (!mItems.isEmpty())
+        updateBudget(mItems.begin().value());
+}
 
-    int start = qMax(0, sheetNum - CACHE_PRE);
-    int end = qMin(project->previewSheetCount()-1, sheetNum + CACHE_POST);
 
-    for (int i=start; i<sheetNum; ++i)
-    {
-        if (!mItems.contains(i))
-            mRender->renderSheet(i);
-    }
+/************************************************
+ *
+ ************************************************/
+void RenderCache::updateBudget(const QImage &img)
+{
+    qint64 size = qMax(qint64(1), qint64(img.bytesPerLine()) * img.height());
+    mPolicy.setBudget(qBound(qint64(1), mMemoryBudget / size, qint64(MAX_BUDGET)));
+}
 
-    for (int i=sheetNum+1; i<=end; ++i)
-    {
-        if (!mItems.contains(i))
-            mRender->renderSheet(i);
-    }
+
+/************************************************
+ *
+ ************************************************/
+void RenderCache::renderSheet(int sheetNum)
+{
+    int sheetCount = project->previewSheetCount();
+    mPolicy.visit(sheetNum, mClock.elapsed());
+    mWindow = mPolicy.window(sheetNum, sheetCount);
 
     // Remove old values ........................
     QHash<int, QImage>::iterator it = mItems.begin();
     while (it != mItems.end())
     {
-        if (it.key() < start || it.key() > end)
+        if (!mWindow.contains(it.key()))
             it = mItems.erase(it);
         else
             ++it;
     }
+
+    // The queued requests are issued again in the new order,
+    // the sheets the user has moved past are dropped.
+    QSet<int>::iterator p = mPending.begin();
+    while (p != mPending.end())
+    {
+        if (mRender->cancelSheet(*p))
+            p = mPending.erase(p);
+        else
+            ++p;
+    }
+
+    if (mItems.contains(sheetNum))
+        emit sheetReady(mItems.value(sheetNum), sheetNum);
+
+    // The current sheet goes to the head of the render queue,
+    // the prefetch requests are kept in the planned order.
+    foreach (int n, mPolicy.plan(sheetNum, sheetCount))
+    {
+        if (mItems.contains(n) || mPending.contains(n))
+            continue;
+
+        mPending << n;
+        if (n == sheetNum)
+            mRender->renderSheet(n);
+        else
+            mRender->prefetchSheet(n);
+    }
 }
 
 
@@ -128,7 +174,8 @@ void RenderCache::renderSheet(int sheetNum)
  ************************************************/
 void RenderCache::cancelSheet(int sheetNum)
 {
-    mRender->cancelSheet(sheetNum);
+    if (mRender->cancelSheet(sheetNum))
+        mPending.remove(sheetNum);
 }
 
 
@@ -137,7 +184,26 @@ void RenderCache::cancelSheet(int sheetNum)
  ************************************************/
 void RenderCache::onSheetReady(const QImage &img, int sheetNum)
 {
-    mItems.insert(sheetNum, img);
+    // While the render is busy, the interval between the results
+    // gives the time one worker spends on one sheet.
+    qint64 now = mClock.elapsed();
+    if (mBusy)
+    {
+        qint64 interval = qMin(now - mLastReadyTime, qint64(MAX_INTERVAL));
+        mReadyInterval = mReadyInterval ? 0.7 * mReadyInterval + 0.3 * interval : interval;
+        mPolicy.setRenderTime(int(mReadyInterval * mThreadCount));
+    }
+
+    mPending.remove(sheetNum);
+    mLastReadyTime = now;
+    mBusy = !mPending.isEmpty();
+
+    if (mItems.isEmpty())
+        updateBudget(img);
+
+    if (mWindow.contains(sheetNum))
+        mItems.insert(sheetNum, img);
+
     emit sheetReady(img, sheetNum);
 }
 
@@ -148,6 +214,8 @@ void RenderCache::onSheetReady(const QImage &img, int sheetNum)
  ************************************************/
 PreviewWidget::PreviewWidget(QWidget *parent) :
     QFrame(parent),
+    mPixmapGrayscale(false),
+    mShadowColor(0),
     mDisplayedSheetNum(-1),
     mScaleFactor(0),
     mWheelDelta(0)
@@ -242,15 +310,8 @@ int PreviewWidget::pageAt(const QPoint &point) const
 /************************************************
  *
  ************************************************/
-void PreviewWidget::drawShadow(QPainter &painter, const QRectF &rect)
+static void paintShadow(QPainter &painter, const QRectF &rect, int width, const QColor &lightColor)
 {
-    // Shadow width
-    int width = qBound(4, int(qMax(rect.height(), rect.width())) / 100, 7);
-
-    painter.save();
-    painter.setClipRect(rect.adjusted(0, 0, width, width));
-
-    QColor lightColor = this->palette().color(QPalette::Background);
     QColor darkColor  = lightColor.darker(160);
 
     QRectF shadowRect = rect.adjusted(0, 0, width, width);
@@ -296,12 +357,90 @@ void PreviewWidget::drawShadow(QPainter &painter, const QRectF &rect)
     rg.setCenter(p);
     rg.setFocalPoint(p);
     painter.fillRect(rect.left(), rect.bottom(), width, width, rg);
+}
+
+
+/************************************************
+ The shadow of the small (2 * width + 1) square.
+ The corners are copied as is, and the 1 pixel
+ wide middle parts are stretched along the edges.
+ ************************************************/
+const QPixmap &PreviewWidget::shadowPixmap(int width)
+{
+    QColor color = this->palette().color(QPalette::Background);
+    int size = 2 * width + 1;
+
+    if (mShadow.width() != size + width || mShadowColor != color.rgb())
+    {
+        mShadow = QPixmap(size + width, size + width);
+        mShadow.fill(Qt::transparent);
+        mShadowColor = color.rgb();
+
+        QPainter painter(&mShadow);
+        paintShadow(painter, QRectF(0, 0, size, size), width, color);
+    }
+
+    return mShadow;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void PreviewWidget::drawShadow(QPainter &painter, const QRectF &rect)
+{
+    // Shadow width
+    int width = qBound(4, int(qMax(rect.height(), rect.width())) / 100, 7);
+    const QPixmap &tpl = shadowPixmap(width);
+    int size = 2 * width + 1;
 
+    painter.save();
+    painter.setClipRect(rect.adjusted(0, 0, width, width));
+
+    // Top right corner ..........
+    painter.drawPixmap(QRectF(rect.right(), rect.top(), width, width), tpl,
+                       QRectF(size, 0, width, width));
+    // Right .....................
+    painter.drawPixmap(QRectF(rect.right(), rect.top() + width, width, rect.height() - width), tpl,
+                       QRectF(size, width, width, 1));
+    // Bottom right corner .......
+    painter.drawPixmap(QRectF(rect.right(), rect.bottom(), width, width), tpl,
+                       QRectF(size, size, width, width));
+    // Bottom ....................
+    painter.drawPixmap(QRectF(rect.left() + width, rect.bottom(), rect.width() - width, width), tpl,
+                       QRectF(width, size, 1, width));
+    // Bottom left corner ........
+    painter.drawPixmap(QRectF(rect.left(), rect.bottom(), width, width), tpl,
+                       QRectF(0, size, width, width));
 
     painter.restore();
 }
 
 
+/************************************************
+ The scaled sheet image is kept until the image,
+ the widget size or the color mode is changed.
+ ************************************************/
+const QPixmap &PreviewWidget::sheetPixmap(const QSize &size, bool grayscale)
+{
+    qreal ratio = devicePixelRatioF();
+    QSize deviceSize = size * ratio;
+
+    if (mPixmap.isNull() || mPixmap.size() != deviceSize || mPixmapGrayscale != grayscale)
+    {
+        QImage img = mImage.scaled(deviceSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        if (grayscale)
+            img = toGrayscale(img);
+
+        mPixmap = QPixmap::fromImage(img);
+        mPixmap.setDevicePixelRatio(ratio);
+        mPixmapGrayscale = grayscale;
+    }
+
+    return mPixmap;
+}
+
+
 /************************************************
 
  ************************************************/
@@ -422,9 +561,7 @@ void PreviewWidget::paintEvent(QPaintEvent *)
     }
 
 
-    QImage img = mImage.scaled(mDrawRect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-    if (grayscale)
-        img = toGrayscale(img);
+    const QPixmap &img = sheetPixmap(mDrawRect.size(), grayscale);
 
     // Draw .....................................
     QPainter painter(this);
@@ -446,7 +583,7 @@ void PreviewWidget::paintEvent(QPaintEvent *)
 
         imgRect = img.rect();
         imgRect.setRight(img.rect().center().x());
-        painter.drawImage(clipRect, img, imgRect);
+        painter.drawPixmap(clipRect, img, imgRect);
         drawShadow(painter, clipRect);
 
         clipRect = mDrawRect;
@@ -456,7 +593,7 @@ void PreviewWidget::paintEvent(QPaintEvent *)
 
         imgRect = img.rect();
         imgRect.setLeft(img.rect().center().x());
-        painter.drawImage(clipRect, img, imgRect);
+        painter.drawPixmap(clipRect, img, imgRect);
         drawShadow(painter, clipRect);
 
         painter.restore();
@@ -465,7 +602,7 @@ void PreviewWidget::paintEvent(QPaintEvent *)
     {
         painter.save();
         painter.setClipRect(clipRect);
-        painter.drawImage(mDrawRect, img);
+        painter.drawPixmap(mDrawRect, img);
         drawShadow(painter, clipRect);
         painter.restore();
     }
@@ -543,6 +680,7 @@ void PreviewWidget::sheetImageReady(const QImage &image, int sheetNum)
         sheetNum <= qMax(mDisplayedSheetNum, curSheet))
     {
         mImage = image;
+        mPixmap = QPixmap();
         mDisplayedSheetNum = sheetNum;
         mHints = mRequests.value(sheetNum);
         update();
@@ -560,6 +698,7 @@ void PreviewWidget::refresh()
     if (!sheet)
     {
         mImage = QImage();
+        mPixmap = QPixmap();
         update();
         return;
     }
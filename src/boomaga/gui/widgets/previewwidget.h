@@ -31,6 +31,10 @@
 #include <QFrame>
 #include "kernel/sheet.h"
 #include <QHash>
+#include <QSet>
+#include <QPixmap>
+#include <QElapsedTimer>
+#include "prefetchpolicy.h"
 
 class Render;
 
@@ -42,6 +46,10 @@ public:
     ~RenderCache();
     QString fileName() const;
 
+    /// The cache keeps as many sheets as fit into the budget (in bytes).
+    qint64 memoryBudget() const { return mMemoryBudget; }
+    void setMemoryBudget(qint64 bytes);
+
 public slots:
     void setFileName(const QString &fileName);
     void renderSheet(int sheetNum);
@@ -55,7 +63,18 @@ private slots:
 
 private:
     QHash<int, QImage> mItems;
+    QSet<int> mPending;
     Render *mRender;
+    PrefetchPolicy mPolicy;
+    PrefetchPolicy::Window mWindow;
+    qint64 mMemoryBudget;
+    QElapsedTimer mClock;
+    qint64 mLastReadyTime;
+    double mReadyInterval;
+    bool mBusy;
+    int mThreadCount;
+
+    void updateBudget(const QImage &img);
 };
 
 class PreviewWidget : public QFrame
@@ -87,6 +106,10 @@ private slots:
 
 private:
     QImage mImage;
+    QPixmap mPixmap;        // mImage scaled to the device pixels of mDrawRect
+    bool mPixmapGrayscale;
+    QPixmap mShadow;        // nine-patch template, see shadowPixmap()
+    QRgb mShadowColor;
     QRect mDrawRect;
     int mDisplayedSheetNum;
     double mScaleFactor;
@@ -95,6 +118,8 @@ private:
     RenderCache *mRender;
     int mWheelDelta;
 
+    const QPixmap &sheetPixmap(const QSize &size, bool grayscale);
+    const QPixmap &shadowPixmap(int width);
     void drawShadow(QPainter &painter, const QRectF &rect);
 };
 
@@ -0,0 +1,234 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#include "blobstore.h"
+#include "pdfparser/pdfmappedfile.h"
+#include "pdfparser/pdferrors.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QStringList>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#endif
+
+#define HASH_CHUNK_SIZE (4 * 1024 * 1024)
+
+
+/************************************************
+ * The hashes of the unchanged files are remembered,
+ * so the same job isn't read again on every autosave.
+ ************************************************/
+static QMutex &hashCacheMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+static QHash<QString, QString> &hashCache()
+{
+    static QHash<QString, QString> hash;
+    return hash;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+static PDF::MappedFile mapFile(const QString &fileName, qint64 startPos, qint64 endPos)
+{
+    QFileInfo fi(fileName);
+    if (!fi.exists())
+        throw QObject::tr("I can't read from file '%1'").arg(fileName) + "\n" + QObject::tr("File not found.");
+
+    qint64 end = qMin(endPos, fi.size());
+    if (startPos >= end)
+        return PDF::MappedFile();
+
+    try
+    {
+        PDF::MappedFile res(fileName, startPos, end - startPos);
+        res.advise(PDF::MappedFile::SequentialAccess);
+        return res;
+    }
+    catch (PDF::Error &err)
+    {
+        throw QObject::tr("I can't read from file '%1'").arg(fileName) + "\n" + err.what();
+    }
+}
+
+
+/************************************************
+ *
+ ************************************************/
+BlobStore::BlobStore(const QString &dir):
+    mDir(QDir(dir).absolutePath())
+{
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QString BlobStore::put(const QString &fileName, qint64 startPos, qint64 endPos) const
+{
+    QFileInfo fi(fileName);
+    if (!endPos)
+        endPos = fi.size();
+
+    // The job was loaded from the blob, it's already here.
+    if (fi.absolutePath() == mDir && startPos == 0 && endPos == fi.size())
+        return fi.absoluteFilePath();
+
+    if (!QDir().mkpath(mDir))
+        throw QObject::tr("I can't create directory \"%1\"").arg(mDir);
+
+    QString res = mDir + "/" + hash(fileName, startPos, endPos) + ".pdf";
+    if (QFileInfo(res).exists())
+        return res;
+
+    QString tmp = mDir + "/." + QFileInfo(res).fileName() + ".part";
+    copy(fileName, startPos, endPos, tmp);
+
+    QFile::remove(res);
+    if (!QFile::rename(tmp, res))
+    {
+        QFile::remove(tmp);
+        throw QObject::tr("I can't write to file '%1'").arg(res);
+    }
+
+    return res;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void BlobStore::removeUnreferenced(const QStringList &blobs) const
+{
+    QSet<QString> keep = QSet<QString>::fromList(blobs);
+
+    QDir dir(mDir);
+    foreach (const QFileInfo &fi, dir.entryInfoList(QStringList("*.pdf"), QDir::Files))
+    {
+        if (!keep.contains(fi.absoluteFilePath()))
+            QFile::remove(fi.absoluteFilePath());
+    }
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QString BlobStore::hash(const QString &fileName, qint64 startPos, qint64 endPos) const
+{
+    QFileInfo fi(fileName);
+    QString key = QString("%1:%2:%3:%4:%5")
+            .arg(fi.absoluteFilePath())
+            .arg(startPos)
+            .arg(endPos)
+            .arg(fi.size())
+            .arg(fi.lastModified().toMSecsSinceEpoch());
+
+    {
+        QMutexLocker locker(&hashCacheMutex());
+        QString res = hashCache().value(key);
+        if (!res.isEmpty())
+            return res;
+    }
+
+    PDF::MappedFile map = mapFile(fileName, startPos, endPos);
+    quint64 size = map.size();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (quint64 pos = 0; pos < size; pos += HASH_CHUNK_SIZE)
+        hash.addData(map.data() + pos, qMin(size - pos, quint64(HASH_CHUNK_SIZE)));
+
+    QString res = hash.result().toHex();
+
+    QMutexLocker locker(&hashCacheMutex());
+    hashCache().insert(key, res);
+    return res;
+}
+
+
+/************************************************
+ * First tries to clone the blocks of the source
+ * file, so on btrfs and XFS the blob takes no space.
+ * The offsets of the partial clone must be aligned to
+ * the block size, otherwise the data is copied.
+ ************************************************/
+void BlobStore::copy(const QString &fileName, qint64 startPos, qint64 endPos, const QString &dest) const
+{
+    QFile out(dest);
+    if (!out.open(QFile::WriteOnly | QFile::Truncate))
+        throw QObject::tr("I can't write to file '%1'").arg(dest) + "\n" + out.errorString();
+
+#ifdef Q_OS_LINUX
+    {
+        QFile in(fileName);
+        if (in.open(QFile::ReadOnly))
+        {
+            int res;
+            if (startPos == 0 && endPos == in.size())
+            {
+                res = ioctl(out.handle(), FICLONE, in.handle());
+            }
+            else
+            {
+                struct file_clone_range range;
+                range.src_fd      = in.handle();
+                range.src_offset  = startPos;
+                range.src_length  = endPos - startPos;
+                range.dest_offset = 0;
+                res = ioctl(out.handle(), FICLONERANGE, &range);
+            }
+
+            if (res == 0)
+                return;
+        }
+    }
+#endif
+
+    PDF::MappedFile map = mapFile(fileName, startPos, endPos);
+    if (out.write(map.data(), map.size()) != qint64(map.size()))
+    {
+        QString err = out.errorString();
+        out.remove();
+        throw QObject::tr("I can't write to file '%1'").arg(dest) + "\n" + err;
+    }
+}
@@ -0,0 +1,63 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#ifndef BLOBSTORE_H
+#define BLOBSTORE_H
+
+#include <QString>
+#include <QStringList>
+
+/// The BlobStore class keeps the job PDFs of the autosaved projects.
+///
+/// Each blob is named by the hash of its content, so the same job saved
+/// into many projects is stored only once. Where the file system supports
+/// it, the blob shares the disk blocks with the source file (reflink).
+/// The methods can be called from any thread.
+class BlobStore
+{
+public:
+    explicit BlobStore(const QString &dir);
+
+    QString dir() const { return mDir; }
+
+    /// Stores the bytes from startPos to endPos of the file and returns the
+    /// absolute name of the blob. If endPos is 0, the data is read until the
+    /// end of the file. Throws QString on error.
+    QString put(const QString &fileName, qint64 startPos, qint64 endPos) const;
+
+    /// Removes the blobs that are not in the list of the absolute file names.
+    /// Nothing else removes the blobs, so the caller passes all blobs referred
+    /// by the projects that are still kept.
+    void removeUnreferenced(const QStringList &blobs) const;
+
+private:
+    QString mDir;
+
+    QString hash(const QString &fileName, qint64 startPos, qint64 endPos) const;
+    void copy(const QString &fileName, qint64 startPos, qint64 endPos, const QString &dest) const;
+};
+
+#endif // BLOBSTORE_H
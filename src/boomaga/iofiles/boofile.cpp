@@ -26,8 +26,12 @@
 
 #include "boofile.h"
 #include "pdffile.h"
+#include "pdfparser/pdfmappedfile.h"
+#include "pdfparser/pdferrors.h"
 #include <QFile>
 #include <QFileInfo>
+#include <QDir>
+#include "blobstore.h"
 
 
 /************************************************
@@ -191,6 +195,14 @@ void BooFile::read()
                 else if (subCommand == "JOB_PAGES")
                     pagesSpec = PageSpec::readPagesSpec(value);
 
+                else if (subCommand == "JOB_BLOB")
+                {
+                    QString blob = QFileInfo(mFileName).dir().absoluteFilePath(value);
+                    addJob(blob, 0, QFileInfo(blob).size(), title, pagesSpec);
+                    title.clear();
+                    pagesSpec.clear();
+                }
+
                 else
                     qWarning() << QString("Unknown command '%1' in the line '%2'").arg(subCommand).arg(line);
 
@@ -216,48 +228,7 @@ void BooFile::read()
                         endPos = file.pos() - 1;
                     }
 
-                    PdfFile pdf;
-                    pdf.load(mFileName, startPos, endPos);
-
-                    Job job;
-                    job.setFileName(mFileName);
-                    job.setFilePos(startPos, endPos);
-                    job.setTitle(title);
-
-                    Job pdfJob = pdf.jobs().first();
-
-                    // remove wrong pages .................
-                    {
-                        int cnt = pdfJob.pageCount();
-                        for (int i=pagesSpec.count()-1; i>=0; --i)
-                        {
-                            if (pagesSpec.at(i).pageNum >= cnt)
-                                pagesSpec.removeAt(i);
-                        }
-                    }
-
-                    QVector<int> pageNums;
-                    pageNums.reserve(pagesSpec.count());
-                    foreach(const PageSpec &spec, pagesSpec)
-                        pageNums << spec.pageNum;
-
-                    addPages(pdfJob, pageNums, &job);
-
-                    for(int i=0; i<pagesSpec.count(); ++i)
-                    {
-                        const PageSpec &spec = pagesSpec.at(i);
-                        ProjectPage *page = job.page(i);
-
-                        if (spec.hidden)
-                            page->setVisible(false);
-
-                        if (spec.startBooklet)
-                            page->setManualStartSubBooklet(true);
-
-                        page->setManualRotation(spec.rotation);
-                    }
-
-                    mJobs << job;
+                    addJob(mFileName, startPos, endPos, title, pagesSpec);
                     title.clear();
                     pagesSpec.clear();
                 }
@@ -274,6 +245,57 @@ void BooFile::read()
 }
 
 
+/************************************************
+ *
+ ************************************************/
+void BooFile::addJob(const QString &fileName, qint64 startPos, qint64 endPos,
+                     const QString &title, QList<BooFile::PageSpec> pagesSpec)
+{
+    PdfFile pdf;
+    pdf.load(fileName, startPos, endPos);
+
+    Job job;
+    job.setFileName(fileName);
+    job.setFilePos(startPos, endPos);
+    job.setTitle(title);
+
+    Job pdfJob = pdf.jobs().first();
+
+    // remove wrong pages .................
+    {
+        int cnt = pdfJob.pageCount();
+        for (int i=pagesSpec.count()-1; i>=0; --i)
+        {
+            if (pagesSpec.at(i).pageNum >= cnt)
+                pagesSpec.removeAt(i);
+        }
+    }
+
+    QVector<int> pageNums;
+    pageNums.reserve(pagesSpec.count());
+    foreach(const PageSpec &spec, pagesSpec)
+        pageNums << spec.pageNum;
+
+    addPages(pdfJob, pageNums, &job);
+
+    for(int i=0; i<pagesSpec.count(); ++i)
+    {
+        const PageSpec &spec = pagesSpec.at(i);
+        ProjectPage *page = job.page(i);
+
+        if (spec.hidden)
+            page->setVisible(false);
+
+        if (spec.startBooklet)
+            page->setManualStartSubBooklet(true);
+
+        page->setManualRotation(spec.rotation);
+    }
+
+    mJobs << job;
+}
+
+
 /************************************************
 
  ************************************************/
@@ -297,20 +319,142 @@ static void writeCommand(QFile *out, const QString &command, const QString &data
 /************************************************
 
  ************************************************/
-static QByteArray readJobPDF(const Job &job)
+static PDF::MappedFile mapJobFile(const BooFile::JobRecord &job)
 {
-    QFile file(job.fileName());
-    if(!file.open(QFile::ReadOnly))
+    QFileInfo fi(job.fileName);
+    if (!fi.exists())
+        throw QObject::tr("I can't read from file '%1'").arg(job.fileName) + "\n" + QObject::tr("File not found.");
+
+    qint64 start = job.startPos;
+    qint64 end   = qMin(qint64(job.endPos), fi.size());
+    if (start >= end)
+        return PDF::MappedFile();
+
+    try
+    {
+        // Only the job bytes are mapped, not the whole source file.
+        PDF::MappedFile res(job.fileName, start, end - start);
+        res.advise(PDF::MappedFile::SequentialAccess);
+        return res;
+    }
+    catch (PDF::Error &err)
     {
         throw QObject::tr("I can't read from file '%1'")
-                .arg(job.fileName()) +
+                .arg(job.fileName) +
                 "\n" +
-                file.errorString();
+                err.what();
+    }
+}
+
+
+/************************************************
+
+ ************************************************/
+static QByteArray readJobPDF(const BooFile::JobRecord &job)
+{
+    PDF::MappedFile map = mapJobFile(job);
+    if (!map.size())
+        return QByteArray();
+
+    return QByteArray(map.data(), map.size());
+}
+
+
+/************************************************
+
+ ************************************************/
+static void writeJobPDF(QFile *out, const BooFile::JobRecord &job)
+{
+    PDF::MappedFile map = mapJobFile(job);
+    if (!map.size())
+        return;
+
+    // The data goes directly from the shared mapping, without copying it to the memory.
+    write(out, QByteArray::fromRawData(map.data(), map.size()));
+    if (map.data()[map.size() - 1] != '\n')
+        write(out, "\n");
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QVector<BooFile::JobRecord> BooFile::jobRecords(const JobList &jobs)
+{
+    QVector<JobRecord> res;
+    res.reserve(jobs.count());
+
+    foreach (const Job &job, jobs)
+    {
+        // The job without the PDF data yet can't be saved.
+        if (job.state() != Job::JobReady)
+            continue;
+
+        QStringList pages;
+        for (int p=0; p<job.pageCount(); ++p)
+        {
+            const ProjectPage *page = job.page(p);
+            pages << PageSpec(page->jobPageNum(),
+                              page->visible() == false,
+                              page->manualRotation(),
+                              page->isManualStartSubBooklet()
+                             ).toString();
+        }
+
+        JobRecord rec;
+        rec.title    = job.title(false);
+        rec.pages    = pages.join(",");
+        rec.fileName = job.fileName();
+        rec.startPos = job.fileStartPos();
+        rec.endPos   = job.fileEndPos();
+        res << rec;
+    }
+
+    return res;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QStringList BooFile::blobFiles(const QString &fileName)
+{
+    QStringList res;
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+        return res;
+
+    QDir dir = QFileInfo(fileName).dir();
+    while (!file.atEnd())
+    {
+        QString line = QString::fromUtf8(file.readLine()).trimmed();
+        if (!line.startsWith("@PJL"))
+            continue;
+
+        QString command = line.section(' ', 1, 1, QString::SectionSkipEmpty).toUpper();
+
+        // The file with the embedded PDF data has no blobs.
+        if (command == "ENTER")
+            break;
+
+        if (command != "BOOMAGA")
+            continue;
+
+        QString subCommand = line.section(' ', 2, -1, QString::SectionSkipEmpty)
+                .section('=', 0, 0, QString::SectionSkipEmpty)
+                .trimmed()
+                .toUpper();
+
+        if (subCommand != "JOB_BLOB")
+            continue;
+
+        QString value = line.section('=', 1,-1, QString::SectionSkipEmpty).trimmed();
+        if (value.startsWith('"') || value.startsWith('\''))
+            value = value.mid(1, value.length()-2);
+
+        res << dir.absoluteFilePath(value);
     }
 
-    file.seek(job.fileStartPos());
-    QByteArray res = file.read(job.fileEndPos() - job.fileStartPos());
-    file.close();
     return res;
 }
 
@@ -319,16 +463,36 @@ static QByteArray readJobPDF(const Job &job)
  *
  ************************************************/
 void BooFile::save(const QString &fileName)
+{
+    save(fileName, mMetaData, jobRecords(mJobs));
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void BooFile::save(const QString &fileName, const MetaData &metaData,
+                   const QVector<JobRecord> &jobs, const BlobStore *blobStore)
 {
     QString filePath = QFileInfo(fileName).absoluteFilePath();
 
+    // The blobs are stored before the project file is created,
+    // so the file never refers to the missing blob.
+    QStringList blobs;
+    if (blobStore)
+    {
+        QDir dir = QFileInfo(filePath).dir();
+        foreach (const JobRecord &job, jobs)
+            blobs << dir.relativeFilePath(blobStore->put(job.fileName, job.startPos, job.endPos));
+    }
+
     // If we write the same file, the program may rewrite data before
     // it will readed, so we store the data in the memory.
-    QVector<QByteArray> documents(mJobs.count());
-    for (int i=0; i<mJobs.count(); ++i)
+    QVector<QByteArray> documents(jobs.count());
+    for (int i=0; i<jobs.count(); ++i)
     {
-        const Job &job = mJobs.at(i);
-        if (job.fileName() == filePath)
+        const JobRecord &job = jobs.at(i);
+        if (!blobStore && job.fileName == filePath)
         {
             documents[i] = readJobPDF(job);
         }
@@ -345,39 +509,34 @@ void BooFile::save(const QString &fileName)
     write(&file, "\x1B%-12345X@PJL BOOMAGA_PROJECT\n");
 
 
-    if (!mMetaData.author().isEmpty())
-        writeCommand(&file, "META_AUTHOR", mMetaData.author());
+    if (!metaData.author().isEmpty())
+        writeCommand(&file, "META_AUTHOR", metaData.author());
 
-    if (!mMetaData.title().isEmpty())
-        writeCommand(&file, "META_TITLE", mMetaData.title());
+    if (!metaData.title().isEmpty())
+        writeCommand(&file, "META_TITLE", metaData.title());
 
-    if (!mMetaData.subject().isEmpty())
-        writeCommand(&file, "META_SUBJECT", mMetaData.subject());
+    if (!metaData.subject().isEmpty())
+        writeCommand(&file, "META_SUBJECT", metaData.subject());
 
-    if (!mMetaData.keywords().isEmpty())
-        writeCommand(&file, "META_KEYWORDS", mMetaData.keywords());
+    if (!metaData.keywords().isEmpty())
+        writeCommand(&file, "META_KEYWORDS", metaData.keywords());
 
 
-    for (int i=0; i<mJobs.count(); ++i)
+    for (int i=0; i<jobs.count(); ++i)
     {
-        const Job &job = mJobs.at(i);
+        const JobRecord &job = jobs.at(i);
 
-        QStringList pages;
-        for (int p=0; p<job.pageCount(); ++p)
-        {
-            const ProjectPage *page = job.page(p);
-            pages << PageSpec(page->jobPageNum(),
-                              page->visible() == false,
-                              page->manualRotation(),
-                              page->isManualStartSubBooklet()
-                             ).toString();
-        }
+        writeCommand(&file, "JOB_PAGES", job.pages);
 
-        writeCommand(&file, "JOB_PAGES", pages.join(","));
 
+        if (!job.title.isEmpty())
+            writeCommand(&file, "JOB_TITLE", job.title);
 
-        if (!job.title(false).isEmpty())
-            writeCommand(&file, "JOB_TITLE", job.title(false));
+        if (blobStore)
+        {
+            writeCommand(&file, "JOB_BLOB", blobs.at(i));
+            continue;
+        }
 
         write(&file, "@PJL ENTER LANGUAGE=PDF\n");
 
@@ -390,10 +549,7 @@ void BooFile::save(const QString &fileName)
         }
         else
         {
-            const QByteArray data = readJobPDF(job);
-            write(&file, data);
-            if (!data.endsWith('\n'))
-                write(&file, "\n");
+            writeJobPDF(&file, job);
         }
 
         write(&file, "\x1B%-12345X@PJL\n");
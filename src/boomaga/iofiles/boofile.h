@@ -28,6 +28,9 @@
 #define BOOFILE_H
 
 #include "infile.h"
+#include <QVector>
+
+class BlobStore;
 
 /************************************************
  * File format
@@ -61,6 +64,11 @@
  * Example:
  *  @PJL BOOMAGA JOB_PAGES="1,2::180,B,3:H:90,4:H"
  *
+ * The job PDF can be stored in the separate file instead of the
+ * PDF stream, the autosaved projects refer to the blob store so:
+ *  @PJL BOOMAGA JOB_BLOB="path"         - path of the PDF, relative
+ *                                          to the project file
+ *
  ************************************************/
 class BooFile : public InFile
 {
@@ -73,6 +81,32 @@ public:
     void setJobs(const JobList &value) { mJobs = value; }
     void save(const QString &fileName);
 
+    /// The state of the job that is written to the project file.
+    /// It doesn't refer to the project pages, so it can be written
+    /// from any thread.
+    struct JobRecord
+    {
+        QString title;
+        QString pages;
+        QString fileName;
+        qint64  startPos;
+        qint64  endPos;
+    };
+
+    /// The jobs that are not ready yet are skipped.
+    static QVector<JobRecord> jobRecords(const JobList &jobs);
+
+    /// Returns the absolute names of the blobs the project file refers to.
+    /// Only the header is read, the embedded PDF data is never reached.
+    static QStringList blobFiles(const QString &fileName);
+
+    /// Writes the project file. If blobStore is not null, the job PDFs are
+    /// put in the store, and the file only refers to them.
+    static void save(const QString &fileName,
+                     const MetaData &metaData,
+                     const QVector<JobRecord> &jobs,
+                     const BlobStore *blobStore = 0);
+
 protected:
     void read() override final;
 
@@ -88,6 +122,9 @@ protected:
         bool     hidden;
         bool     startBooklet;
     };
+
+    void addJob(const QString &fileName, qint64 startPos, qint64 endPos,
+                const QString &title, QList<PageSpec> pagesSpec);
 };
 
 #endif // BOOFILE_H
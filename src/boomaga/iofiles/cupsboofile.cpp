@@ -189,7 +189,10 @@ void CupsBooFile::read()
         }
     }
 
-    for (int c=0; c<count; ++c)
+    // All copies refer to the same part of the file, so TmpPdfFile
+    // merges the PDF data only once and the copies share XObjects.
+    mJobs << job;
+    for (int c=1; c<count; ++c)
     {
         mJobs << job.clone();
     }
@@ -27,15 +27,23 @@
 #include "postscriptfile.h"
 #include "pdffile.h"
 #include "boomagatypes.h"
+#include "kernel/projectpage.h"
+#include "pdfparser/pdferrors.h"
 
 #include <QProcess>
 #include <QFile>
+#include <QDebug>
+#include <string.h>
+
+#define WRITE_BUF_SIZE  (4 * 1024 * 1024)
+
 
 /************************************************
  *
  ************************************************/
 PostScriptFile::PostScriptFile(QObject *parent) :
-    InFile(parent)
+    InFile(parent),
+    mBackgroundConversion(false)
 {
 }
 
@@ -45,6 +53,37 @@ PostScriptFile::PostScriptFile(QObject *parent) :
  ************************************************/
 void PostScriptFile::read()
 {
+    if (mBackgroundConversion)
+    {
+        PDF::MappedFile data;
+        try
+        {
+            data = PDF::MappedFile(mFileName, mStartPos, mEndPos - mStartPos);
+        }
+        catch (PDF::Error &err)
+        {
+            throw BoomagaError(tr("I can't read file \"%1\"").arg(mFileName) + "\n" + err.what());
+        }
+
+        data.advise(PDF::MappedFile::SequentialAccess);
+        int pageCount = dscPageCount(data.data(), data.size());
+        if (pageCount > 0)
+        {
+            Job job;
+            job.setState(Job::JobNotReady);
+            for (int i=0; i<pageCount; ++i)
+                job.addPage(new ProjectPage(i));
+
+            mJobs << job;
+
+            // The converter outlives this file object, it's deleted
+            // when the job is updated.
+            PostScriptConverter *conv = new PostScriptConverter(job, data, genTmpFileName("in.pdf"), project);
+            conv->start();
+            return;
+        }
+    }
+
     QFile psFile;
     mustOpenFile(mFileName, &psFile);
     psFile.seek(mStartPos);
@@ -64,7 +103,100 @@ void PostScriptFile::read()
 /************************************************
  *
  ************************************************/
-void PostScriptFile::convertToPdf(QFile &psFile, const QString &pdfFile)
+static bool isDscComment(const char *pos, const char *end, const char *keyword, int len)
+{
+    return end - pos >= len && strncmp(pos, keyword, len) == 0;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+static int readDscNumber(const char *pos, const char *end)
+{
+    while (pos < end && (*pos == ' ' || *pos == '\t'))
+        ++pos;
+
+    // "(atend)" means the value is in the trailer.
+    if (pos == end || *pos < '0' || *pos > '9')
+        return -1;
+
+    int res = 0;
+    while (pos < end && *pos >= '0' && *pos <= '9')
+    {
+        res = res * 10 + (*pos - '0');
+        ++pos;
+    }
+    return res;
+}
+
+
+/************************************************
+ * The comments are found with memmem, which is much
+ * faster than reading the data line by line. Only
+ * the %% at the start of the line is a DSC comment.
+ ************************************************/
+int PostScriptFile::dscPageCount(const char *data, quint64 size)
+{
+    static const char PAGES[]     = "%%Pages:";
+    static const char PAGE[]      = "%%Page:";
+    static const char BEGIN_DOC[] = "%%BeginDocument";
+    static const char END_DOC[]   = "%%EndDocument";
+
+    int pages = -1;
+    int pageComments = 0;
+    int depth = 0;
+
+    const char *end = data + size;
+    const char *pos = data;
+    while (pos < end)
+    {
+        const char *c = static_cast<const char*>(memmem(pos, end - pos, "%%", 2));
+        if (!c)
+            break;
+
+        pos = c + 2;
+        if (c != data && c[-1] != '\n' && c[-1] != '\r')
+            continue;
+
+        if (isDscComment(c, end, BEGIN_DOC, sizeof(BEGIN_DOC) - 1))
+        {
+            ++depth;
+        }
+        else if (isDscComment(c, end, END_DOC, sizeof(END_DOC) - 1))
+        {
+            depth = qMax(0, depth - 1);
+        }
+        else if (depth > 0)
+        {
+            continue;
+        }
+        else if (isDscComment(c, end, PAGES, sizeof(PAGES) - 1))
+        {
+            // The trailer value overrides the header one.
+            int n = readDscNumber(c + sizeof(PAGES) - 1, end);
+            if (n > -1)
+                pages = n;
+        }
+        else if (isDscComment(c, end, PAGE, sizeof(PAGE) - 1))
+        {
+            ++pageComments;
+        }
+    }
+
+    // The page comments are counted directly, %%Pages: is
+    // only what the generator declared.
+    if (pageComments > 0)
+        return pageComments;
+
+    return qMax(pages, 0);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QStringList PostScriptFile::gsArgs(const QString &pdfFile)
 {
     QStringList args;
     args << "-dNOPAUSE";
@@ -75,10 +207,17 @@ void PostScriptFile::convertToPdf(QFile &psFile, const QString &pdfFile)
     args << "-q";
     args << "-c" << ".setpdfwrite";
     args << "-f" << "-";
+    return args;
+}
 
 
+/************************************************
+ *
+ ************************************************/
+void PostScriptFile::convertToPdf(QFile &psFile, const QString &pdfFile)
+{
     QProcess process;
-    process.start("gs", args, QProcess::ReadWrite);
+    process.start("gs", gsArgs(pdfFile), QProcess::ReadWrite);
     if (!process.waitForStarted())
         throw BoomagaError(tr("I can't start gs converter: \"%1\"",
                               "Error message. 'gs' is a command line tool from ghostscript")
@@ -104,3 +243,165 @@ void PostScriptFile::convertToPdf(QFile &psFile, const QString &pdfFile)
                               "Error message. 'gs' is a command line tool from ghostscript")
                            .arg(QString::fromLocal8Bit(process.readAllStandardError())));
 }
+
+
+/************************************************
+ *
+ ************************************************/
+PostScriptConverter::PostScriptConverter(const Job &job, const PDF::MappedFile &psData, const QString &pdfFile, QObject *parent):
+    QObject(parent),
+    mJob(job),
+    mData(psData),
+    mWritten(0),
+    mPdfFile(pdfFile)
+{
+    connect(&mProcess, &QProcess::started,
+            this, &PostScriptConverter::writeData);
+
+    connect(&mProcess, &QProcess::bytesWritten,
+            this, &PostScriptConverter::writeData);
+
+    connect(&mProcess, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, &PostScriptConverter::processFinished);
+
+    connect(&mProcess, &QProcess::errorOccurred,
+            this, &PostScriptConverter::processFailed);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void PostScriptConverter::start()
+{
+    mProcess.start("gs", PostScriptFile::gsArgs(mPdfFile), QProcess::ReadWrite);
+}
+
+
+/************************************************
+ * Keeps about WRITE_BUF_SIZE bytes in the write
+ * buffer, so the large document is never copied
+ * to the memory at once.
+ ************************************************/
+void PostScriptConverter::writeData()
+{
+    while (mWritten < mData.size() && mProcess.bytesToWrite() < WRITE_BUF_SIZE)
+    {
+        quint64 len = qMin(mData.size() - mWritten, quint64(WRITE_BUF_SIZE));
+        mProcess.write(mData.data() + mWritten, len);
+        mWritten += len;
+    }
+
+    if (mWritten == mData.size())
+    {
+        disconnect(&mProcess, &QProcess::bytesWritten,
+                   this, &PostScriptConverter::writeData);
+
+        mProcess.closeWriteChannel();
+    }
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void PostScriptConverter::processFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    mData = PDF::MappedFile();
+
+    if (exitStatus != QProcess::NormalExit || exitCode != 0)
+    {
+        failJob(tr("I can't start gs converter: \"%1\"",
+                   "Error message. 'gs' is a command line tool from ghostscript")
+                .arg(QString::fromLocal8Bit(mProcess.readAllStandardError())));
+        return;
+    }
+
+    try
+    {
+        updateJob();
+    }
+    catch (BoomagaError &err)
+    {
+        failJob(err.what());
+    }
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void PostScriptConverter::processFailed(QProcess::ProcessError error)
+{
+    // The finished() signal is emitted for the crash.
+    if (error != QProcess::FailedToStart)
+        return;
+
+    mData = PDF::MappedFile();
+    failJob(tr("I can't start gs converter: \"%1\"",
+               "Error message. 'gs' is a command line tool from ghostscript")
+            .arg(mProcess.errorString()));
+}
+
+
+/************************************************
+ * The DSC comments can be wrong, so the placeholder
+ * pages beyond the real document are taken out and
+ * the missing ones are added. The user could edit
+ * the pages in the meantime, the edits are kept,
+ * but the history starts again, see Project::updateJob.
+ ************************************************/
+void PostScriptConverter::updateJob()
+{
+    PdfFile pdf;
+    pdf.load(mPdfFile);
+    Job pdfJob = pdf.jobs().first();
+    int pageCount = pdfJob.pageCount();
+
+    bool inProject = project->jobs()->contains(mJob);
+
+    int placeholders = 0;
+    QList<ProjectPage*> taken;
+    foreach (ProjectPage *page, mJob.pages())
+    {
+        placeholders = qMax(placeholders, page->jobPageNum() + 1);
+        if (page->jobPageNum() >= pageCount)
+            taken << mJob.takePage(page);
+    }
+
+    for (int i=placeholders; i<pageCount; ++i)
+        mJob.addPage(new ProjectPage(i));
+
+    mJob.setFileName(pdfJob.fileName());
+    mJob.setFilePos(pdfJob.fileStartPos(), pdfJob.fileEndPos());
+    if (mJob.title(false).isEmpty())
+        mJob.setTitle(pdfJob.title(false));
+    mJob.setState(Job::JobReady);
+
+    // The history refers to the taken pages until it's reset.
+    if (inProject)
+        project->updateJob(mJob);
+
+    qDeleteAll(taken);
+    deleteLater();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void PostScriptConverter::failJob(const QString &error)
+{
+    qWarning() << error;
+    mJob.setState(Job::JobError);
+    mJob.setErrorString(error);
+
+    int n = project->jobs()->indexOf(mJob);
+    if (n > -1)
+    {
+        project->removeJob(n);
+        project->error(error);
+    }
+
+    deleteLater();
+}
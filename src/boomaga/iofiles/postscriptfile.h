@@ -28,6 +28,8 @@
 #define POSTSCRIPTFILE_H
 
 #include "infile.h"
+#include "pdfparser/pdfmappedfile.h"
+#include <QProcess>
 
 class QFile;
 
@@ -38,11 +40,55 @@ public:
     explicit PostScriptFile(QObject *parent = 0);
     Type type() const override final { return Type::PostScript; }
 
+    /// If true and the document has DSC page comments, read() returns the job
+    /// with the placeholder pages at once. The job is JobNotReady until gs
+    /// converts the document to PDF in the background, then the pages get
+    /// the real page info and the project is updated.
+    bool backgroundConversion() const { return mBackgroundConversion; }
+    void setBackgroundConversion(bool value) { mBackgroundConversion = value; }
+
+    /// Returns the page count from the %%Page: or %%Pages: DSC comments of the
+    /// PostScript data, or 0 if there are no such comments. The comments of the
+    /// embedded documents are ignored.
+    static int dscPageCount(const char *data, quint64 size);
+
+    static QStringList gsArgs(const QString &pdfFile);
+
 protected:
     void read() override final;
 
 private:
     void convertToPdf(QFile &psFile, const QString &pdfFile);
+
+    bool mBackgroundConversion;
+};
+
+
+/// The PostScriptConverter class runs gs for the job created by the
+/// PostScriptFile with the background conversion. The PostScript data is
+/// written to gs from the mapped file, so the event loop is never blocked.
+class PostScriptConverter: public QObject
+{
+    Q_OBJECT
+public:
+    PostScriptConverter(const Job &job, const PDF::MappedFile &psData, const QString &pdfFile, QObject *parent = 0);
+
+    void start();
+
+private slots:
+    void writeData();
+    void processFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void processFailed(QProcess::ProcessError error);
+
+private:
+    Job             mJob;
+    PDF::MappedFile mData;
+    quint64         mWritten;
+    QString         mPdfFile;
+    QProcess        mProcess;
+
+    void updateJob();
+    void failJob(const QString &error);
 };
 
 #endif // POSTSCRIPTFILE_H
@@ -48,6 +48,7 @@ public:
     qint64 mEndPos;
     QList<ProjectPage*> mPages;
     QString mTitle;
+    Job::State mState;
     QString mErrorString;
 
     static int lockUnlockFile(const QString &file, int lock);
@@ -61,7 +62,8 @@ public:
 JobData::JobData():
     mFileName(""),
     mStartPos(0),
-    mEndPos(0)
+    mEndPos(0),
+    mState(Job::JobReady)
 {
 }
 
@@ -178,7 +180,26 @@ int Job::pageCount() const
  ************************************************/
 ProjectPage *Job::page(int index) const
 {
-    return mData->mPages[index];
+    return mData->mPages.at(index);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QList<ProjectPage *> Job::pages() const
+{
+    return mData->mPages;
+}
+
+
+/************************************************
+ * The job doesn't delete the pages that are
+ * not in the new list.
+ ************************************************/
+void Job::setPages(const QList<ProjectPage *> &pages)
+{
+    mData->mPages = pages;
 }
 
 
@@ -346,6 +367,24 @@ void Job::setFilePos(qint64 startPos, qint64 endPos)
 }
 
 
+/************************************************
+
+ ************************************************/
+Job::State Job::state() const
+{
+    return mData->mState;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void Job::setState(Job::State state)
+{
+    mData->mState = state;
+}
+
+
 /************************************************
 
  ************************************************/
@@ -355,6 +394,15 @@ QString Job::errorString() const
 }
 
 
+/************************************************
+ *
+ ************************************************/
+void Job::setErrorString(const QString &value)
+{
+    mData->mErrorString = value;
+}
+
+
 /************************************************
  *
  * ***********************************************/
@@ -418,6 +466,14 @@ int JobList::indexOfProjectPage(const ProjectPage * page, int from) const
     if (!page)
         return -1;
 
+    QHash<const ProjectPage*, PagePos>::const_iterator it = mIndex.constFind(page);
+    if (it != mIndex.constEnd() && it->job >= from && it->job < count())
+    {
+        const Job &job = at(it->job);
+        if (it->page < job.pageCount() && job.page(it->page) == page)
+            return it->job;
+    }
+
     for(int i=from; i<this->count(); ++i)
     {
         if (at(i).indexOfPage(page) > -1)
@@ -428,3 +484,22 @@ int JobList::indexOfProjectPage(const ProjectPage * page, int from) const
 }
 
 
+/************************************************
+ *
+ ************************************************/
+void JobList::updateIndex()
+{
+    mIndex.clear();
+
+    for (int j=count()-1; j>=0; --j)
+    {
+        const Job &job = at(j);
+        for (int p=job.pageCount()-1; p>=0; --p)
+        {
+            PagePos pos = { j, p };
+            mIndex.insert(job.page(p), pos);
+        }
+    }
+}
+
+
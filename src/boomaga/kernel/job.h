@@ -28,6 +28,7 @@
 #define JOB_H
 
 #include <QList>
+#include <QHash>
 #include <QObject>
 #include <QString>
 
@@ -58,6 +59,8 @@ public:
 
     int pageCount() const;
     ProjectPage *page(int index) const;
+    QList<ProjectPage*> pages() const;
+    void setPages(const QList<ProjectPage*> &pages);
     int visiblePageCount() const;
     ProjectPage *firstVisiblePage() const;
 
@@ -80,7 +83,13 @@ public:
     qint64 fileEndPos() const;
     void setFilePos(qint64 startPos, qint64 endPos);
 
+    /// A job is JobNotReady while its PDF data is prepared in the background,
+    /// such a job has the placeholder pages and no file yet.
+    State state() const;
+    void setState(State state);
+
     QString errorString() const;
+    void setErrorString(const QString &value);
 
     ProjectPage *insertBlankPage(int before);
     ProjectPage *addBlankPage();
@@ -98,6 +107,22 @@ public:
     JobList(const QList<Job> & other);
 
     int indexOfProjectPage(const ProjectPage *page, int from = 0) const;
+
+    /// Rebuilds the page-to-job index used by indexOfProjectPage.
+    /// The lookups stay correct if the jobs are changed later,
+    /// but they fall back to the linear search until the next call.
+    /// A stale entry is checked against its job only, so this holds
+    /// as long as a page belongs to one job of the list.
+    void updateIndex();
+
+private:
+    struct PagePos
+    {
+        int job;
+        int page;
+    };
+
+    QHash<const ProjectPage*, PagePos> mIndex;
 };
 
 #endif // JOB_H
@@ -158,7 +158,7 @@ TransformSpec LayoutNUp::transformSpec(const Sheet *sheet, int pageNumOnSheet, R
 
     uint col, row;
     {
-        Direction direction = settings->value(Settings::RightToLeft).toBool() ? RightToLeft : LeftToRight;
+        Direction direction = settings->snapshot().rightToLeft ? RightToLeft : LeftToRight;
         PagePosition colRow = calcPagePosition(pageNumOnSheet, sheetRotation, direction);
         col = colRow.col;
         row = colRow.row;
@@ -562,7 +562,7 @@ void LayoutBooklet::fillPreviewSheets(QList<Sheet *> *sheets, Direction directio
  ************************************************/
 void LayoutBooklet::updatePages(QList<ProjectPage *> pages) const
 {
-    if (!settings->value(Settings::SubBookletsEnabled).toBool())
+    if (!settings->snapshot().subBookletsEnabled)
     {
         foreach (ProjectPage *page, pages)
             page->setAutoStartSubBooklet(false);
@@ -571,7 +571,7 @@ void LayoutBooklet::updatePages(QList<ProjectPage *> pages) const
     else
     {
 
-        int pagePerBook = settings->value(Settings::SubBookletSize).toInt() * 4;
+        int pagePerBook = settings->snapshot().subBookletSize * 4;
 
         int n = pagePerBook;
         foreach (ProjectPage *page, pages)
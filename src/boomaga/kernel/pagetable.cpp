@@ -0,0 +1,183 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2012-2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#include "pagetable.h"
+#include <QVarLengthArray>
+
+
+/************************************************
+ *
+ ************************************************/
+PageTable::PageTable()
+{
+}
+
+
+/************************************************
+ *
+ ************************************************/
+PageTable *PageTable::instance()
+{
+    static PageTable *inst = 0;
+    if (!inst)
+        inst = new PageTable();
+
+    return inst;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+PageTable::Row PageTable::addRow(int jobPageNum)
+{
+    Row row;
+    if (!mFreeRows.isEmpty())
+    {
+        row = mFreeRows.takeLast();
+        mJobPageNum[row]     = jobPageNum;
+        mFlags[row]          = Visible;
+        mManualRotation[row] = NoRotate;
+        mPdfRotate[row]      = 0;
+        mMediaBox[row]       = QRectF();
+        mCropBox[row]        = QRectF();
+        mXObjCount[row]      = 0;
+        return row;
+    }
+
+    row = mJobPageNum.count();
+    mJobPageNum     << jobPageNum;
+    mFlags          << Visible;
+    mManualRotation << NoRotate;
+    mPdfRotate      << 0;
+    mMediaBox       << QRectF();
+    mCropBox        << QRectF();
+    mXObjStart      << mXObjNums.count();
+    mXObjCount      << 0;
+    mXObjCapacity   << 0;
+    mGeneration     << 0;
+    return row;
+}
+
+
+/************************************************
+ * The auto sub-booklet flag is calculated by the layout,
+ * so it is not copied.
+ ************************************************/
+void PageTable::copyRow(PageTable::Row from, PageTable::Row to)
+{
+    mJobPageNum[to]     = mJobPageNum.at(from);
+    mFlags[to]          = mFlags.at(from) & ~AutoStartSubBooklet;
+    mManualRotation[to] = mManualRotation.at(from);
+    mPdfRotate[to]      = mPdfRotate.at(from);
+    mMediaBox[to]       = mMediaBox.at(from);
+    mCropBox[to]        = mCropBox.at(from);
+
+    // mXObjNums can be reallocated in setXObjNums, so we copy the numbers first.
+    QVarLengthArray<uint, 4> nums(mXObjCount.at(from));
+    for (int i=0; i<nums.count(); ++i)
+        nums[i] = xObjNum(from, i);
+
+    setXObjNums(to, nums.constData(), nums.count());
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void PageTable::releaseRow(PageTable::Row row)
+{
+    mXObjCount[row] = 0;
+    ++mGeneration[row];
+    mFreeRows << row;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void PageTable::setFlag(PageTable::Row row, PageTable::Flag flag, bool value)
+{
+    if (value)
+        mFlags[row] = mFlags.at(row) | flag;
+    else
+        mFlags[row] = mFlags.at(row) & ~flag;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+PdfPageInfo PageTable::pdfInfo(PageTable::Row row) const
+{
+    PdfPageInfo res;
+    res.mediaBox = mMediaBox.at(row);
+    res.cropBox  = mCropBox.at(row);
+    res.rotate   = mPdfRotate.at(row);
+
+    for (int i=0; i<mXObjCount.at(row); ++i)
+        res.xObjNums << xObjNum(row, i);
+
+    return res;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void PageTable::setPdfInfo(PageTable::Row row, const PdfPageInfo &value)
+{
+    mMediaBox[row]  = value.mediaBox;
+    mCropBox[row]   = value.cropBox;
+    mPdfRotate[row] = value.rotate;
+
+    QVarLengthArray<uint, 4> nums(value.xObjNums.count());
+    for (int i=0; i<nums.count(); ++i)
+        nums[i] = value.xObjNums.at(i);
+
+    setXObjNums(row, nums.constData(), nums.count());
+}
+
+
+/************************************************
+ * The row reuses its own range of the pool when the new
+ * numbers fit into it, otherwise a new range is appended.
+ ************************************************/
+void PageTable::setXObjNums(PageTable::Row row, const uint *nums, int count)
+{
+    if (count > mXObjCapacity.at(row))
+    {
+        mXObjStart[row]    = mXObjNums.count();
+        mXObjCapacity[row] = count;
+        mXObjNums.resize(mXObjNums.count() + count);
+    }
+
+    int start = mXObjStart.at(row);
+    for (int i=0; i<count; ++i)
+        mXObjNums[start + i] = nums[i];
+
+    mXObjCount[row] = count;
+}
@@ -0,0 +1,108 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2012-2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#ifndef PAGETABLE_H
+#define PAGETABLE_H
+
+#include <QVector>
+#include <QRectF>
+#include "boomagatypes.h"
+
+/************************************************
+ * The PageTable class keeps the state of all project pages
+ * as a structure of arrays. A ProjectPage is only a light
+ * handle which holds the row number in this table, so
+ * cloning, hiding or rotating pages never touches the heap
+ * and walking over all pages is cache friendly.
+ *
+ * The XObject numbers of all pages are stored in the one
+ * pool, every row refers to the range in this pool.
+ ************************************************/
+class PageTable
+{
+public:
+    typedef int Row;
+
+    enum Flag
+    {
+        Visible               = 1,
+        ManualStartSubBooklet = 2,
+        AutoStartSubBooklet   = 4
+    };
+
+    static PageTable *instance();
+
+    Row  addRow(int jobPageNum = -1);
+    void copyRow(Row from, Row to);
+    void releaseRow(Row row);
+
+    int rowCount() const { return mJobPageNum.count() - mFreeRows.count(); }
+
+    /// The generation of the row grows every time the row is released,
+    /// so a stale reference to the row can be recognized.
+    quint32 generation(Row row) const { return mGeneration.at(row); }
+
+    int jobPageNum(Row row) const { return mJobPageNum.at(row); }
+
+    bool flag(Row row, Flag flag) const { return mFlags.at(row) & flag; }
+    void setFlag(Row row, Flag flag, bool value);
+
+    Rotation manualRotation(Row row) const { return Rotation(mManualRotation.at(row)); }
+    void setManualRotation(Row row, Rotation value) { mManualRotation[row] = value; }
+
+    const QRectF &mediaBox(Row row) const { return mMediaBox.at(row); }
+    const QRectF &cropBox(Row row)  const { return mCropBox.at(row); }
+    int pdfRotate(Row row) const { return mPdfRotate.at(row); }
+
+    int  xObjCount(Row row) const { return mXObjCount.at(row); }
+    uint xObjNum(Row row, int index) const { return mXObjNums.at(mXObjStart.at(row) + index); }
+
+    PdfPageInfo pdfInfo(Row row) const;
+    void setPdfInfo(Row row, const PdfPageInfo &value);
+
+private:
+    PageTable();
+    Q_DISABLE_COPY(PageTable)
+
+    void setXObjNums(Row row, const uint *nums, int count);
+
+    QVector<int>     mJobPageNum;
+    QVector<quint8>  mFlags;
+    QVector<qint16>  mManualRotation;
+    QVector<qint16>  mPdfRotate;
+    QVector<QRectF>  mMediaBox;
+    QVector<QRectF>  mCropBox;
+    QVector<int>     mXObjStart;
+    QVector<quint16> mXObjCount;
+    QVector<quint16> mXObjCapacity;
+    QVector<uint>    mXObjNums;
+    QVector<quint32> mGeneration;
+    QVector<Row>     mFreeRows;
+};
+
+#define pageTable PageTable::instance()
+
+#endif // PAGETABLE_H
@@ -61,6 +61,8 @@ PdfProcessor::~PdfProcessor()
 void PdfProcessor::open()
 {
     mReader.open(mFileName, mStartPos, mEndPos);
+    // All objects of the document will be copied to the writer.
+    mReader.advise(PDF::MappedFile::SequentialAccess);
 }
 
 
@@ -80,25 +82,50 @@ void PdfProcessor::run(PDF::Writer *writer, quint32 objNumOffset)
 {
     mWriter = writer;
     mObjNumOffset = objNumOffset;
+    mProcessedObjects.resize(mReader.xRefTable().maxObjNum() + 1);
 
     PDF::Object catalog = mReader.getObject(mReader.trailerDict().value("Root").asLink());
     PDF::Object pages   = mReader.getObject(catalog.dict().value("Pages").asLink());
 
     mPageInfo.reserve(pages.dict().value("Count").asNumber().value());
 
-    PDF::Dict dict;
-    walkPageTree(0, pages, dict);
+    mReader.prefetchObjectStreams();
+
+    walkPageTree(pages);
 
     writer = nullptr;
 }
 
 
+static const char * const INHERITABLE_ATTR_NAMES[] = {
+    "Resources",
+    "MediaBox",
+    "CropBox",
+    "Rotate"
+};
+
+
+/************************************************
+ *
+ ************************************************/
+const PDF::Value PdfProcessor::Inherited::value(InheritableAttr attr, const PDF::Value &defaultValue) const
+{
+    if (owner[attr])
+        return owner[attr]->value(INHERITABLE_ATTR_NAMES[attr]);
+
+    return defaultValue;
+}
+
+
 /************************************************
  *
  ************************************************/
-void fillPageInfo(PdfPageInfo *pageInfo, const PDF::Dict &pageDict, const PDF::Dict &inherited)
+static void fillPageInfo(PdfPageInfo *pageInfo, const PDF::Dict &pageDict,
+                         const PDF::Value &inheritedMediaBox,
+                         const PDF::Value &inheritedCropBox,
+                         const PDF::Value &inheritedRotate)
 {
-    const PDF::Array &mediaBox = pageDict.value("MediaBox", inherited.value("MediaBox")).asArray();
+    const PDF::Array &mediaBox = pageDict.value("MediaBox", inheritedMediaBox).asArray();
     if (mediaBox.count() != 4)
         throw QString("Incorrect MediaBox rectangle");
 
@@ -107,7 +134,7 @@ void fillPageInfo(PdfPageInfo *pageInfo, const PDF::Dict &pageDict, const PDF::D
                                 mediaBox.at(2).asNumber().value() - mediaBox.at(0).asNumber().value(),
                                 mediaBox.at(3).asNumber().value() - mediaBox.at(1).asNumber().value());
 
-    const PDF::Array &cropBox  = pageDict.value("CropBox", inherited.value("CropBox")).asArray();
+    const PDF::Array &cropBox  = pageDict.value("CropBox", inheritedCropBox).asArray();
     if (cropBox.isValid())
     {
         if (cropBox.count() != 4)
@@ -122,64 +149,122 @@ void fillPageInfo(PdfPageInfo *pageInfo, const PDF::Dict &pageDict, const PDF::D
     {
         pageInfo->cropBox = pageInfo->mediaBox;
     }
-    pageInfo->rotate = pageDict.value("Rotate", inherited.value("Rotate")).asNumber().value();
+    pageInfo->rotate = pageDict.value("Rotate", inheritedRotate).asNumber().value();
 
 }
 
 
 /************************************************
- *
+ Walks the page tree without recursion. Every Pages node on
+ the current path is kept on the stack together with its
+ kids, which are read in one batch when the node is entered.
+ Instead of copying the inherited attributes into a new Dict
+ for every node, each stack entry only remembers which node
+ on the path defines each inheritable attribute.
  ************************************************/
-int PdfProcessor::walkPageTree(int pageNum, const PDF::Object &page, const PDF::Dict &inherited)
+void PdfProcessor::walkPageTree(const PDF::Object &root)
 {
-    assert(page.type() == "Pages" || page.type() == "Page");
+    struct Node
+    {
+        PDF::Object pages;
+        QVector<PDF::Object> kids;
+        int next;
+        int owner[AttrCount];
+    };
 
-    // Type = Pages .......................................
-    if (page.type() == "Pages")
+    if (root.type() == "Page")
     {
-        const PDF::Dict &pageDict = page.dict();
-        PDF::Dict dict = inherited;
-        if (pageDict.contains("Resources"))
-            dict.insert("Resources", pageDict.value("Resources"));
+        Inherited inherited = {};
+        processPage(root, inherited);
+        return;
+    }
 
-        if (pageDict.contains("MediaBox"))
-            dict.insert("MediaBox",  pageDict.value("MediaBox"));
+    QVector<Node> stack;
+    stack.reserve(16);
+    QBitArray visited(mReader.xRefTable().maxObjNum() + 1);
 
-        if (pageDict.contains("CropBox"))
-            dict.insert("CropBox",   pageDict.value("CropBox"));
+    auto enter = [&](const PDF::Object &pages) {
+        if (pages.objNum() < uint(visited.size()))
+        {
+            if (visited.testBit(pages.objNum()))
+                throw QString("Page tree contains a loop at object %1 %2").arg(pages.objNum()).arg(pages.genNum());
+            visited.setBit(pages.objNum());
+        }
 
-        if (pageDict.contains("Rotate"))
-            dict.insert("Rotate",    pageDict.value("Rotate"));
+        Node node;
+        node.pages = pages;
+        node.next  = 0;
+        const PDF::Dict &dict = node.pages.dict();
+        for (int a=0; a<AttrCount; ++a)
+        {
+            if (dict.contains(INHERITABLE_ATTR_NAMES[a]))
+                node.owner[a] = stack.count();
+            else
+                node.owner[a] = stack.isEmpty() ? -1 : stack.last().owner[a];
+        }
 
-        const PDF::Array kids = pageDict.value("Kids").asArray();
+        const PDF::Array &kids = dict.value("Kids").asArray();
+        node.kids.reserve(kids.count());
         for (int i=0; i<kids.count(); ++i)
+            node.kids << mReader.getObject(kids.at(i).asLink());
+
+        stack << node;
+    };
+
+    enter(root);
+    while (!stack.isEmpty())
+    {
+        Node &top = stack.last();
+        if (top.next == top.kids.count())
         {
-            pageNum = walkPageTree(pageNum, mReader.getObject(kids.at(i).asLink()), dict);
+            stack.removeLast();
+            continue;
         }
-        return pageNum;
-    }
 
-    // Type = Page ........................................
-    if (page.type() == "Page")
-    {
-        PdfPageInfo pageInfo;
-        try
+        const PDF::Object kid = top.kids.at(top.next++);
+
+        if (kid.type() == "Pages")
         {
-            fillPageInfo(&pageInfo, page.dict(), inherited);
+            enter(kid);
+            continue;
         }
-        catch (const QString &err)
+
+        if (kid.type() == "Page")
         {
-            throw QString("Error on page %1 %2: %3").arg(page.objNum()).arg(page.genNum()).arg(err);
+            Inherited inherited;
+            for (int a=0; a<AttrCount; ++a)
+            {
+                int n = top.owner[a];
+                inherited.owner[a] = (n < 0) ? nullptr : &(stack.at(n).pages.dict());
+            }
+
+            processPage(kid, inherited);
         }
+    }
+}
 
-        pageInfo.xObjNums << writePageAsXObject(page, inherited);
-        mPageInfo << pageInfo;
-        emit pageReady();
 
-        return pageNum + 1;
+/************************************************
+ *
+ ************************************************/
+void PdfProcessor::processPage(const PDF::Object &page, const Inherited &inherited)
+{
+    PdfPageInfo pageInfo;
+    try
+    {
+        fillPageInfo(&pageInfo, page.dict(),
+                     inherited.value(AttrMediaBox),
+                     inherited.value(AttrCropBox),
+                     inherited.value(AttrRotate));
+    }
+    catch (const QString &err)
+    {
+        throw QString("Error on page %1 %2: %3").arg(page.objNum()).arg(page.genNum()).arg(err);
     }
 
-    return pageNum;
+    pageInfo.xObjNums << writePageAsXObject(page, inherited);
+    mPageInfo << pageInfo;
+    emit pageReady();
 }
 
 
@@ -243,7 +328,7 @@ int PdfProcessor::walkPageTree(int pageNum, const PDF::Object &page, const PDF::
     (including potential white space) as intended by the page’s creator. The default
     value is the page’s crop box.
  ************************************************/
-PDF::ObjNum PdfProcessor::writePageAsXObject(const PDF::Object &page, const PDF::Dict &inherited)
+PDF::ObjNum PdfProcessor::writePageAsXObject(const PDF::Object &page, const Inherited &inherited)
 {
     const PDF::Dict &pageDict = page.dict();
 
@@ -256,9 +341,9 @@ PDF::ObjNum PdfProcessor::writePageAsXObject(const PDF::Object &page, const PDF:
     dict.insert("Subtype",  PDF::Name("Form"));
     dict.insert("FormType", PDF::Number(1));
 
-    dict.insert("Resources", pageDict.value("Resources", inherited.value("Resources")));
-    dict.insert("BBox",      pageDict.value("CropBox",  inherited.value("CropBox",
-                             pageDict.value("MediaBox", inherited.value("MediaBox")))));
+    dict.insert("Resources", pageDict.value("Resources", inherited.value(AttrResources)));
+    dict.insert("BBox",      pageDict.value("CropBox",  inherited.value(AttrCropBox,
+                             pageDict.value("MediaBox", inherited.value(AttrMediaBox)))));
 
     if (pageDict.contains("Metadata"))      dict.insert("Metadata",      pageDict.value("Metadata"));
     if (pageDict.contains("PieceInfo"))     dict.insert("PieceInfo",     pageDict.value("PieceInfo"));
@@ -340,32 +425,38 @@ void PdfProcessor::offsetValue(PDF::Value &value)
     if (value.isLink())
     {
         PDF::Link &link = value.asLink();
-        if (!mProcessedObjects.contains(link.objNum()))
+        const PDF::ObjNum num = link.objNum();
+
+        // A link to the object which is not in the file is
+        // a valid PDF, it is treated as a null object.
+        if (qint64(num) > mReader.xRefTable().maxObjNum())
+        {
+            value = PDF::Null();
+            return;
+        }
+
+        if (!mProcessedObjects.testBit(num))
         {
-            mProcessedObjects << link.objNum();
+            mProcessedObjects.setBit(num);
             PDF::Object obj = mReader.getObject(link);
             addOffset(obj);
         }
-        link.setObjNum(link.objNum() + mObjNumOffset);
+        link.setObjNum(num + mObjNumOffset);
     }
 
+    // The children are changed in place, without copying the keys
+    // and looking up every one of them.
     if (value.isArray())
     {
-        PDF::Array &arr = value.asArray();
-
-        for (int i=0; i<arr.count(); ++i)
-        {
-            offsetValue(arr[i]);
-        }
+        QVector<PDF::Value> &values = value.asArray().values();
+        for (auto i = values.begin(); i != values.end(); ++i)
+            offsetValue(*i);
     }
 
     if (value.isDict())
     {
-        PDF::Dict &dict = value.asDict();
-
-        foreach (auto &key, dict.keys())
-        {
-            offsetValue(dict[key]);
-        }
+        QMap<QString, PDF::Value> &values = value.asDict().values();
+        for (auto i = values.begin(); i != values.end(); ++i)
+            offsetValue(i.value());
     }
 }
@@ -30,7 +30,7 @@
 #include <QVector>
 #include <QString>
 #include <QFile>
-#include <QSet>
+#include <QBitArray>
 #include "pdfparser/pdfvalue.h"
 #include "pdfparser/pdfreader.h"
 #include "boomagatypes.h"
@@ -68,10 +68,28 @@ private:
     quint32 mObjNumOffset;
     PDF::Writer *mWriter;
     QVector<PdfPageInfo> mPageInfo;
-    QSet<PDF::ObjNum> mProcessedObjects;
+    QBitArray mProcessedObjects;
 
-    int walkPageTree(int pageNum, const PDF::Object &page, const PDF::Dict &inherited);
-    PDF::ObjNum writePageAsXObject(const PDF::Object &page, const PDF::Dict &inherited);
+    /// The page attributes which can be inherited from the parent Pages nodes.
+    enum InheritableAttr {
+        AttrResources,
+        AttrMediaBox,
+        AttrCropBox,
+        AttrRotate,
+        AttrCount
+    };
+
+    /// Points to the Pages dictionaries that define each inheritable
+    /// attribute, nullptr if attribute is not defined by any parent.
+    struct Inherited
+    {
+        const PDF::Dict *owner[AttrCount];
+        const PDF::Value value(InheritableAttr attr, const PDF::Value &defaultValue = PDF::Value()) const;
+    };
+
+    void walkPageTree(const PDF::Object &root);
+    void processPage(const PDF::Object &page, const Inherited &inherited);
+    PDF::ObjNum writePageAsXObject(const PDF::Object &page, const Inherited &inherited);
     PDF::Object &addOffset(PDF::Object &obj);
     void offsetValue(PDF::Value &value);
 };
@@ -33,6 +33,7 @@
 #include "layout.h"
 #include "iofiles/infile.h"
 #include "iofiles/boofile.h"
+#include "iofiles/postscriptfile.h"
 
 #include <unistd.h>
 #include <fstream>
@@ -46,9 +47,14 @@
 #include <QDateTime>
 #include <QUuid>
 #include <QUrl>
+#include <QDataStream>
 
 #define META_SIZE (4 * 1024)
 
+// The header of the file written by saveMerged().
+static const quint32 MERGED_MAGIC   = 0x424d5247; // "BMRG"
+static const quint32 MERGED_VERSION = 1;
+
 using namespace  std;
 
 class ProjectState
@@ -69,7 +75,7 @@ public:
 
 private:
     const Project *mProject;
-    const ProjectPage *mCurrentPage;
+    ProjectPagePointer mCurrentPage;
     const Sheet *mCurrentSheet;
 };
 
@@ -88,7 +94,8 @@ Project::Project(QObject *parent) :
     mNullPrinter("Fake"),
     mPrinter(&mNullPrinter),
     mDoubleSided(true),
-    mRotation(NoRotate)
+    mRotation(NoRotate),
+    mInteractive(true)
 {
 }
 
@@ -115,6 +122,7 @@ void Project::free()
         }
     }
 
+    mHistory.reset(JobList());
     mJobs.clear();
     delete mTmpFile;
 }
@@ -158,6 +166,7 @@ void Project::addJobs(const JobList &jobs)
             mJobs << job;
         }
 
+        resetHistory();
         stopMerging();
         update();
 
@@ -184,6 +193,7 @@ void Project::removeJob(int index)
 
         QString fileName = mJobs.at(index).fileName();
         mJobs.removeAt(index);
+        resetHistory();
         update();
 
         if (fileName.endsWith(AUTOREMOVE_EXT))
@@ -207,16 +217,145 @@ void Project::removeJob(int index)
 }
 
 
+/************************************************
+ * The PDF data of the job that was added as
+ * JobNotReady is ready, so the tmp file is merged
+ * again. The pages are already in their places.
+ * The conversion isn't an edit, the old versions
+ * can have the placeholder pages that are not in
+ * the document, so the history starts again.
+ ************************************************/
+void Project::updateJob(const Job &job)
+{
+    if (!mJobs.contains(job))
+        return;
+
+    try
+    {
+        resetHistory();
+        stopMerging();
+        update();
+
+        mLastTmpFile = createTmpPdfFile();
+        mLastTmpFile->merge(mJobs);
+    }
+    catch (BoomagaError &err)
+    {
+        qWarning() << Q_FUNC_INFO << err.what();
+        error(err.what());
+    }
+}
+
+
+/************************************************
+
+ ************************************************/
+void Project::removeAllJobs()
+{
+    try
+    {
+        stopMerging();
+
+        for (const Job &job: mJobs)
+        {
+            if (job.fileName().endsWith(AUTOREMOVE_EXT))
+                QFile(job.fileName()).remove();
+        }
+
+        mJobs.clear();
+        resetHistory();
+        update();
+
+        mLastTmpFile = createTmpPdfFile();
+        mLastTmpFile->merge(mJobs);
+    }
+    catch (BoomagaError &err)
+    {
+        qWarning() << Q_FUNC_INFO << err.what();
+        error(err.what());
+    }
+}
+
+
 /************************************************
 
  ************************************************/
 void Project::moveJob(int from, int to)
 {
     mJobs.move(from, to);
+    commitHistory(QList<Job>());
     update();
 }
 
 
+/************************************************
+ *
+ ************************************************/
+void Project::undo()
+{
+    if (!mHistory.canUndo())
+        return;
+
+    mHistory.undo(&mJobs);
+    emit historyChanged();
+    update();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void Project::redo()
+{
+    if (!mHistory.canRedo())
+        return;
+
+    mHistory.redo(&mJobs);
+    emit historyChanged();
+    update();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void Project::resetHistory()
+{
+    mHistory.reset(mJobs);
+    emit historyChanged();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void Project::commitHistory(const QList<Job> &changed)
+{
+    mHistory.commit(mJobs, changed);
+    emit historyChanged();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void Project::commitEdit(const Job &job)
+{
+    commitHistory(QList<Job>() << job);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void Project::commitEdit(const ProjectPage *page)
+{
+    int n = mJobs.indexOfProjectPage(page);
+    if (n > -1)
+        commitHistory(QList<Job>() << mJobs.at(n));
+}
+
+
 /************************************************
 
  ************************************************/
@@ -278,6 +417,7 @@ void Project::update()
             }
         }
     }
+    mJobs.updateIndex();
     mRotation = calcRotation(mPages, mLayout);
 
     if (!mPages.isEmpty())
@@ -301,7 +441,7 @@ void Project::update()
         mLayout->updatePages(mPages);
         mSheetCount = mLayout->calcSheetCount();
 
-        Direction direction = settings->value(Settings::RightToLeft).toBool() ? RightToLeft : LeftToRight;
+        Direction direction = settings->snapshot().rightToLeft ? RightToLeft : LeftToRight;
         mLayout->fillPreviewSheets(&mPreviewSheets, direction);
 
         if (mTmpFile)
@@ -321,6 +461,8 @@ void Project::update()
         }
     }
 
+    mPreviewSheets.updateIndex();
+
     if (mCurrentPage)
         mCurrentSheet = mCurrentPage->sheet();
     else
@@ -410,20 +552,18 @@ void Project::deletePage(ProjectPage *page)
         nextCurPage = prevVisiblePage(page);
 
 
-    if (page->isBlankPage())
-    {
-        int n = mJobs.indexOfProjectPage(page);
-        if (n<0)
-            return;
+    int n = mJobs.indexOfProjectPage(page);
+    if (n<0)
+        return;
 
-        mJobs.value(n).removePage(page);
-    }
+    // The blank page is kept by the history for undo.
+    Job job = mJobs.value(n);
+    if (page->isBlankPage())
+        job.takePage(page);
     else
-    {
         page->hide();
-    }
-
 
+    commitEdit(job);
     mCurrentPage = nextCurPage;
     update();
 }
@@ -438,6 +578,7 @@ void Project::undoDeletePage(ProjectPage *page)
         return;
 
     page->show();
+    commitEdit(page);
     mCurrentPage = page;
     update();
 }
@@ -471,7 +612,11 @@ void Project::deletePagesEnd(ProjectPage *page)
             p->hide();
     }
 
-    job.removePages(deleted);
+    // The blank pages are kept by the history for undo.
+    foreach (ProjectPage *p, deleted)
+        job.takePage(p);
+
+    commitEdit(job);
     mCurrentPage = nextCurPage;
     update();
 }
@@ -488,6 +633,7 @@ void Project::insertBlankPageBefore(ProjectPage *page)
 
     Job job = jobs()->value(j);
     mCurrentPage = job.insertBlankPage(job.indexOfPage(page));
+    commitEdit(job);
     this->update();
 }
 
@@ -503,6 +649,7 @@ void Project::insertBlankPageAfter(ProjectPage *page)
 
     Job job = jobs()->value(j);
     mCurrentPage = job.insertBlankPage(job.indexOfPage(page) + 1);
+    commitEdit(job);
     this->update();
 }
 
@@ -730,6 +877,12 @@ void Project::tmpFileProgress(int progr, int all) const
  ************************************************/
 bool Project::error(const QString &message) const
 {
+    if (!mInteractive)
+    {
+        qWarning() << message;
+        return false;
+    }
+
     QMessageBox::critical(0, tr("Boomaga", "Error message title"), message);
     qWarning() << message;
     return false;
@@ -789,6 +942,12 @@ QList<Sheet*> Project::selectSheets(Project::PagesType pages, Project::PagesOrde
  ************************************************/
 bool Project::writeDocument(const QList<Sheet*> &sheets, QIODevice *out)
 {
+    foreach (const Job &job, mJobs)
+    {
+        if (job.state() == Job::JobNotReady)
+            return error(tr("The document is not ready yet, the PostScript is still being converted to PDF."));
+    }
+
     return mTmpFile->writeDocument(sheets, out);
 }
 
@@ -1089,6 +1248,13 @@ JobList Project::load(const QStringList &fileNames)
 
             QObject keeper;
             InFile *parser = InFile::fromFile(fileName, &keeper);
+
+            // In the GUI the pages of the PostScript job are shown at once,
+            // the service needs the complete document.
+            PostScriptFile *ps = qobject_cast<PostScriptFile*>(parser);
+            if (ps)
+                ps->setBackgroundConversion(mInteractive);
+
             connect(parser, &InFile::startLongOperation,
                     [this, &parser](const QString &msg){
                 auto task = new ProjectLongTask(msg, parser);
@@ -1127,10 +1293,17 @@ JobList Project::load(const QStringList &fileNames)
 
 
 /************************************************
-
+ * The jobs that are still converted would be
+ * missing in the saved file.
  ************************************************/
 void Project::save(const QString &fileName)
 {
+    foreach (const Job &job, mJobs)
+    {
+        if (job.state() == Job::JobNotReady)
+            throw tr("The project can't be saved yet, the PostScript is still being converted to PDF.");
+    }
+
     BooFile file;
     file.setMetadata(mMetaData);
     file.setJobs(mJobs);
@@ -1138,6 +1311,225 @@ void Project::save(const QString &fileName)
 }
 
 
+/************************************************
+ * The tmp file stays in use until the other process
+ * confirms it took the state, see releaseMerged().
+ ************************************************/
+bool Project::saveMerged(const QString &fileName)
+{
+    if (!mTmpFile || !mTmpFile->isValid() || mLastTmpFile)
+        return false;
+
+    foreach (const Job &job, mJobs)
+    {
+        if (job.state() != Job::JobReady)
+            return false;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+        return false;
+
+    QDataStream out(&file);
+    out << MERGED_MAGIC << MERGED_VERSION;
+    out << mMetaData.author()
+        << mMetaData.title()
+        << mMetaData.subject()
+        << mMetaData.keywords();
+
+    mTmpFile->writeState(out);
+
+    out << qint32(mJobs.count());
+    foreach (const Job &job, mJobs)
+    {
+        out << job.fileName()
+            << job.fileStartPos()
+            << job.fileEndPos()
+            << job.title(false)
+            << qint32(job.pageCount());
+
+        for (int p=0; p<job.pageCount(); ++p)
+        {
+            const ProjectPage *page = job.page(p);
+            PdfPageInfo info = page->pdfInfo();
+            out << qint32(page->jobPageNum())
+                << page->visible()
+                << qint32(page->manualRotation())
+                << page->isManualStartSubBooklet()
+                << info.xObjNums
+                << info.mediaBox
+                << info.cropBox
+                << qint32(info.rotate);
+        }
+    }
+
+    if (out.status() != QDataStream::Ok || !file.flush())
+    {
+        file.remove();
+        return false;
+    }
+
+    return true;
+}
+
+
+/************************************************
+ * The process that called loadMerged() shares the
+ * data of the tmp file, so it mustn't be written
+ * anymore.
+ ************************************************/
+void Project::releaseMerged()
+{
+    if (mTmpFile)
+        mTmpFile->release();
+}
+
+
+/************************************************
+ * The job files are created by the service, they
+ * are linked under our own name, so they outlive
+ * the jobs of the service. The service keeps its
+ * files until the hand-off is confirmed.
+ ************************************************/
+static QString takeServiceFile(const QString &fileName, QHash<QString, QString> *renamed)
+{
+    if (renamed->contains(fileName))
+        return renamed->value(fileName);
+
+    QString res = fileName;
+    QFileInfo fi(fileName);
+    if (fi.absolutePath() == QDir(boomagaChacheDir()).absolutePath())
+    {
+        QString newName = genTmpFileName("." + fi.completeSuffix());
+        if (::link(QFile::encodeName(fileName).constData(), QFile::encodeName(newName).constData()) == 0 ||
+            QFile::copy(fileName, newName))
+        {
+            res = newName;
+        }
+    }
+
+    renamed->insert(fileName, res);
+    return res;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+bool Project::loadMerged(const QString &fileName)
+{
+    if (!mJobs.isEmpty())
+        return false;
+
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    quint32 magic, version;
+    in >> magic >> version;
+    if (magic != MERGED_MAGIC || version != MERGED_VERSION)
+        return false;
+
+    QString author, title, subject, keywords;
+    in >> author >> title >> subject >> keywords;
+
+    TmpPdfFile *tmpFile = createTmpPdfFile();
+    if (!tmpFile->readState(in))
+    {
+        delete tmpFile;
+        return false;
+    }
+
+    struct PageRecord
+    {
+        qint32 jobPageNum;
+        bool   visible;
+        qint32 rotation;
+        bool   startSubBooklet;
+        PdfPageInfo info;
+    };
+
+    struct JobRecord
+    {
+        QString fileName;
+        qint64  startPos;
+        qint64  endPos;
+        QString title;
+        QVector<PageRecord> pages;
+    };
+
+    qint32 jobCount;
+    in >> jobCount;
+    QVector<JobRecord> records(qMax(jobCount, 0));
+    for (int j=0; j<records.count() && in.status() == QDataStream::Ok; ++j)
+    {
+        JobRecord &rec = records[j];
+        qint32 pageCount;
+        in >> rec.fileName >> rec.startPos >> rec.endPos >> rec.title >> pageCount;
+
+        rec.pages.resize(qMax(pageCount, 0));
+        for (int p=0; p<rec.pages.count() && in.status() == QDataStream::Ok; ++p)
+        {
+            PageRecord &page = rec.pages[p];
+            qint32 rotate;
+            in >> page.jobPageNum
+               >> page.visible
+               >> page.rotation
+               >> page.startSubBooklet
+               >> page.info.xObjNums
+               >> page.info.mediaBox
+               >> page.info.cropBox
+               >> rotate;
+            page.info.rotate = rotate;
+        }
+    }
+
+    if (in.status() != QDataStream::Ok)
+    {
+        delete tmpFile;
+        return false;
+    }
+
+    QHash<QString, QString> renamed;
+    JobList jobs;
+    foreach (const JobRecord &rec, records)
+    {
+        Job job;
+        job.setFileName(takeServiceFile(rec.fileName, &renamed));
+        job.setFilePos(rec.startPos, rec.endPos);
+        job.setTitle(rec.title);
+
+        foreach (const PageRecord &rp, rec.pages)
+        {
+            ProjectPage *page = rp.jobPageNum < 0 ? new ProjectPage() : new ProjectPage(rp.jobPageNum);
+            page->setVisible(rp.visible);
+            page->setManualRotation(Rotation(rp.rotation));
+            page->setManualStartSubBooklet(rp.startSubBooklet);
+            page->setPdfInfo(rp.info);
+            job.addPage(page);
+        }
+        jobs << job;
+    }
+
+    stopMerging();
+    delete mTmpFile;
+    mTmpFile = tmpFile;
+
+    mJobs = jobs;
+    mMetaData.setAuthor(author);
+    mMetaData.setTitle(title);
+    mMetaData.setSubject(subject);
+    mMetaData.setKeywords(keywords);
+    if (mMetaData.title().isEmpty() && !mJobs.isEmpty())
+        mMetaData.setTitle(mJobs.first().title());
+
+    resetHistory();
+    update();
+    return true;
+}
+
+
 /************************************************
  *
  ************************************************/
@@ -35,12 +35,12 @@
 #include <QList>
 #include <QStringList>
 #include <QImage>
-#include <QPointer>
 
 class Job;
 class TmpPdfFile;
 class Layout;
 #include "sheet.h"
+#include "projecthistory.h"
 
 class MetaData
 {
@@ -145,8 +145,28 @@ public:
 
     void save(const QString &fileName);
 
+    /// Writes the jobs with the page info and hands the merged tmp file over
+    /// to the process that calls loadMerged(), so it doesn't parse and merge
+    /// the jobs again. The project doesn't change, until the other process
+    /// confirms the hand-off. Returns false if nothing was written.
+    bool saveMerged(const QString &fileName);
+
+    /// Stops writing the tmp file after the other process took it with
+    /// loadMerged(). The jobs should be removed afterwards.
+    void releaseMerged();
+
+    /// Loads the jobs and takes over the tmp file written by saveMerged().
+    /// Works only for the empty project. Returns false on error, then the
+    /// project is not changed.
+    bool loadMerged(const QString &fileName);
+
     Rotation rotation() const { return mRotation; }
 
+    /// If interactive is false, errors are only logged, the project
+    /// doesn't show any message boxes. It's used by the headless service.
+    bool isInteractive() const { return mInteractive; }
+    void setInteractive(bool value) { mInteractive = value; }
+
 public:
     ProjectPage *currentPage() const { return mCurrentPage; }
     int currentPageNum() const;
@@ -165,6 +185,14 @@ public:
     ProjectPage *prevVisiblePage(ProjectPage *current) const;
     ProjectPage *nextVisiblePage(ProjectPage *current) const;
 
+    bool canUndo() const { return mHistory.canUndo(); }
+    bool canRedo() const { return mHistory.canRedo(); }
+
+    /// Stores the version of the project for undo after the pages of the job
+    /// were edited outside the Project. Adding or removing jobs clears the history.
+    void commitEdit(const Job &job);
+    void commitEdit(const ProjectPage *page);
+
 public slots:
     JobList load(const QString &fileName);
     JobList load(const QStringList &fileNames);
@@ -190,7 +218,11 @@ public slots:
     void addJob(const Job &job);
     void addJobs(const JobList &jobs);
     void removeJob(int index);
+    void removeAllJobs();
     void moveJob(int from, int to);
+    void updateJob(const Job &job);
+    void undo();
+    void redo();
     void setLayout(const Layout *layout);
     void setDoubleSided(bool value);
     void update();
@@ -205,6 +237,7 @@ signals:
     void currentSheetChanged(Sheet *sheet);
     void currentSheetChanged(int sheet);
     void longTaskStarted(const ProjectLongTask *task);
+    void historyChanged();
 
 protected:
     Rotation calcRotation(const QList<ProjectPage *> &pages, const Layout *layout) const;
@@ -217,11 +250,15 @@ private:
     explicit Project(QObject *parent = 0);
     ~Project();
 
+    void resetHistory();
+    void commitHistory(const QList<Job> &changed);
+
     const Layout *mLayout;
     QList<ProjectPage*> mPages;
-    QPointer<ProjectPage> mCurrentPage;
+    ProjectPagePointer mCurrentPage;
     Sheet *mCurrentSheet;
     JobList mJobs;
+    ProjectHistory mHistory;
 
     int mSheetCount;
     SheetList mPreviewSheets;
@@ -234,6 +271,7 @@ private:
 
     MetaData mMetaData;
     Rotation mRotation;
+    bool mInteractive;
 
     TmpPdfFile *createTmpPdfFile();
     void stopMerging();
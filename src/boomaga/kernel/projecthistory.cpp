@@ -0,0 +1,294 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#include "projecthistory.h"
+#include "projectpage.h"
+
+
+/************************************************
+ *
+ ************************************************/
+bool ProjectHistory::JobVersion::isSharedWith(const ProjectHistory::JobVersion &other) const
+{
+    return job == other.job &&
+           pages.isSharedWith(other.pages) &&
+           states.isSharedWith(other.states);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+ProjectHistory::ProjectHistory(int depth):
+    mDepth(qMax(depth, 2)),
+    mCurrent(-1)
+{
+}
+
+
+/************************************************
+ *
+ ************************************************/
+ProjectHistory::~ProjectHistory()
+{
+    clear();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void ProjectHistory::clear()
+{
+    qDeleteAll(mDetached);
+    mDetached.clear();
+    mVersions.clear();
+    mCurrent = -1;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void ProjectHistory::reset(const JobList &jobs)
+{
+    clear();
+
+    Version version;
+    version.reserve(jobs.count());
+    foreach (const Job &job, jobs)
+        version << jobVersion(job);
+
+    mVersions << version;
+    mCurrent = 0;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void ProjectHistory::commit(const JobList &jobs, const QList<Job> &changed)
+{
+    if (mVersions.isEmpty())
+    {
+        reset(jobs);
+        return;
+    }
+
+    // The pages that were created after the current version
+    // aren't referred by the rest of the history.
+    while (canRedo())
+    {
+        foreach (const JobVersion &jv, mVersions.last())
+        {
+            foreach (ProjectPage *page, jv.pages)
+            {
+                if (mDetached.remove(page))
+                    delete page;
+            }
+        }
+        mVersions.removeLast();
+    }
+
+    const Version &prev = mVersions.at(mCurrent);
+    Version version;
+    version.reserve(jobs.count());
+
+    foreach (const Job &job, jobs)
+    {
+        const JobVersion *old = find(prev, job);
+        if (old && !changed.contains(job))
+        {
+            version << *old;
+            continue;
+        }
+
+        JobVersion jv = jobVersion(job);
+        if (old)
+            detach(old->pages, jv.pages);
+
+        version << jv;
+    }
+
+    mVersions << version;
+    ++mCurrent;
+
+    if (mVersions.count() > mDepth)
+        dropFirst();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void ProjectHistory::undo(JobList *jobs)
+{
+    if (canUndo())
+        apply(mCurrent - 1, jobs);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void ProjectHistory::redo(JobList *jobs)
+{
+    if (canRedo())
+        apply(mCurrent + 1, jobs);
+}
+
+
+/************************************************
+ * Only the jobs that differ from the current
+ * version are touched.
+ ************************************************/
+void ProjectHistory::apply(int index, JobList *jobs)
+{
+    const Version &cur  = mVersions.at(mCurrent);
+    const Version &next = mVersions.at(index);
+
+    JobList res;
+    res.reserve(next.count());
+
+    foreach (const JobVersion &jv, next)
+    {
+        Job job = jv.job;
+        const JobVersion *old = find(cur, job);
+
+        if (!old || !old->isSharedWith(jv))
+        {
+            if (old)
+                detach(old->pages, jv.pages);
+
+            job.setPages(jv.pages);
+            for (int i=0; i<jv.pages.count(); ++i)
+            {
+                ProjectPage *page = jv.pages.at(i);
+                const PageState &state = jv.states.at(i);
+                page->setVisible(state.visible);
+                page->setManualStartSubBooklet(state.startSubBooklet);
+                page->setManualRotation(state.rotation);
+            }
+        }
+
+        res << job;
+    }
+
+    *jobs = res;
+    mCurrent = index;
+}
+
+
+/************************************************
+ * The pages of the first version that the second
+ * one doesn't refer to aren't used anymore.
+ ************************************************/
+void ProjectHistory::dropFirst()
+{
+    const Version &first  = mVersions.at(0);
+    const Version &second = mVersions.at(1);
+
+    foreach (const JobVersion &jv, first)
+    {
+        const JobVersion *next = find(second, jv.job);
+        if (next && next->pages.isSharedWith(jv.pages))
+            continue;
+
+        QSet<ProjectPage*> keep;
+        if (next)
+            keep = next->pages.toSet();
+
+        foreach (ProjectPage *page, jv.pages)
+        {
+            if (!keep.contains(page) && mDetached.remove(page))
+                delete page;
+        }
+    }
+
+    mVersions.removeFirst();
+    --mCurrent;
+}
+
+
+/************************************************
+ * The pages that left the job are owned by the
+ * history, the returned ones by the job again.
+ ************************************************/
+void ProjectHistory::detach(const QList<ProjectPage *> &from, const QList<ProjectPage *> &to)
+{
+    QSet<ProjectPage*> fromSet = from.toSet();
+    QSet<ProjectPage*> toSet   = to.toSet();
+
+    foreach (ProjectPage *page, from)
+    {
+        if (!toSet.contains(page))
+            mDetached.insert(page);
+    }
+
+    foreach (ProjectPage *page, to)
+    {
+        if (!fromSet.contains(page))
+            mDetached.remove(page);
+    }
+}
+
+
+/************************************************
+ *
+ ************************************************/
+ProjectHistory::JobVersion ProjectHistory::jobVersion(const Job &job)
+{
+    JobVersion res;
+    res.job   = job;
+    res.pages = job.pages();
+    res.states.reserve(res.pages.count());
+
+    foreach (const ProjectPage *page, res.pages)
+    {
+        PageState state;
+        state.visible         = page->visible();
+        state.startSubBooklet = page->isManualStartSubBooklet();
+        state.rotation        = page->manualRotation();
+        res.states << state;
+    }
+
+    return res;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+const ProjectHistory::JobVersion *ProjectHistory::find(const ProjectHistory::Version &version, const Job &job)
+{
+    for (int i=0; i<version.count(); ++i)
+    {
+        if (version.at(i).job == job)
+            return &version.at(i);
+    }
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#ifndef PROJECTHISTORY_H
+#define PROJECTHISTORY_H
+
+#include <QList>
+#include <QVector>
+#include <QSet>
+#include "job.h"
+#include "boomagatypes.h"
+
+class ProjectPage;
+
+/// The ProjectHistory class keeps the versions of the jobs for undo and redo.
+///
+/// A version holds the page list of every job and the states of its pages.
+/// The lists are implicitly shared, so a new version copies only the lists of
+/// the jobs changed by the edit and shares the rest with the previous version.
+/// Undo and redo only move to another version and apply the jobs that differ.
+///
+/// The pages removed from the jobs are owned by the history while some version
+/// refers to them, so the undo can return them.
+class ProjectHistory
+{
+public:
+    explicit ProjectHistory(int depth = 100);
+    ~ProjectHistory();
+
+    bool canUndo() const { return mCurrent > 0; }
+    bool canRedo() const { return mCurrent < mVersions.count() - 1; }
+
+    /// Drops all versions, the first version is made from the jobs.
+    void reset(const JobList &jobs);
+
+    /// Adds the version after the edit, the redo versions are dropped.
+    /// Only the changed jobs are read, for the others the lists of
+    /// the previous version are used.
+    void commit(const JobList &jobs, const QList<Job> &changed);
+
+    void undo(JobList *jobs);
+    void redo(JobList *jobs);
+
+private:
+    struct PageState
+    {
+        bool     visible;
+        bool     startSubBooklet;
+        Rotation rotation;
+    };
+
+    struct JobVersion
+    {
+        Job job;
+        QList<ProjectPage*>  pages;
+        QVector<PageState>   states;
+
+        bool isSharedWith(const JobVersion &other) const;
+    };
+
+    typedef QVector<JobVersion> Version;
+
+    int mDepth;
+    QList<Version> mVersions;
+    int mCurrent;
+    QSet<ProjectPage*> mDetached;
+
+    static JobVersion jobVersion(const Job &job);
+    static const JobVersion *find(const Version &version, const Job &job);
+    void detach(const QList<ProjectPage*> &from, const QList<ProjectPage*> &to);
+    void apply(int index, JobList *jobs);
+    void dropFirst();
+    void clear();
+};
+
+#endif // PROJECTHISTORY_H
@@ -30,15 +30,10 @@
 /************************************************
 
  ************************************************/
-ProjectPage::ProjectPage(QObject *parent):
-    QObject(parent),
-    mJobPageNum(-1),
+ProjectPage::ProjectPage():
+    mRow(pageTable->addRow()),
     mPageNum(-1),
-    mSheet(0),
-    mVisible(true),
-    mManualRotation(NoRotate),
-    mManualStartSubBooklet(false),
-    mAutoStartSubBooklet(false)
+    mSheet(0)
 {
 
 }
@@ -47,15 +42,10 @@ ProjectPage::ProjectPage(QObject *parent):
 /************************************************
  *
  ************************************************/
-ProjectPage::ProjectPage(int jobPageNum, QObject *parent):
-    QObject(parent),
-    mJobPageNum(jobPageNum),
+ProjectPage::ProjectPage(int jobPageNum):
+    mRow(pageTable->addRow(jobPageNum)),
     mPageNum(-1),
-    mSheet(0),
-    mVisible(true),
-    mManualRotation(NoRotate),
-    mManualStartSubBooklet(false),
-    mAutoStartSubBooklet(false)
+    mSheet(0)
 {
 }
 
@@ -65,6 +55,7 @@ ProjectPage::ProjectPage(int jobPageNum, QObject *parent):
  ************************************************/
 ProjectPage::~ProjectPage()
 {
+    pageTable->releaseRow(mRow);
 }
 
 
@@ -73,8 +64,9 @@ ProjectPage::~ProjectPage()
  * ***********************************************/
 QRectF ProjectPage::rect() const
 {
-    if (mPdfInfo.cropBox.isValid())
-        return mPdfInfo.cropBox;
+    const QRectF &cropBox = pageTable->cropBox(mRow);
+    if (cropBox.isValid())
+        return cropBox;
     else
         return project->printer()->paperRect();
 }
@@ -85,7 +77,7 @@ QRectF ProjectPage::rect() const
  ************************************************/
 Rotation ProjectPage::pdfRotation() const
 {
-    int r = mPdfInfo.rotate % 360;
+    int r = pageTable->pdfRotate(mRow) % 360;
 
     if (r == 90)    return Rotate90;
     if (r == 180)   return Rotate180;
@@ -99,7 +91,7 @@ Rotation ProjectPage::pdfRotation() const
  ************************************************/
 void ProjectPage::setVisible(bool value)
 {
-    mVisible = value;
+    pageTable->setFlag(mRow, PageTable::Visible, value);
 }
 
 
@@ -108,7 +100,7 @@ void ProjectPage::setVisible(bool value)
  ************************************************/
 bool ProjectPage::isBlankPage() const
 {
-    return mJobPageNum < 0;
+    return jobPageNum() < 0;
 }
 
 
@@ -117,7 +109,7 @@ bool ProjectPage::isBlankPage() const
  ************************************************/
 void ProjectPage::setManualStartSubBooklet(bool value)
 {
-    mManualStartSubBooklet = value;
+    pageTable->setFlag(mRow, PageTable::ManualStartSubBooklet, value);
 }
 
 
@@ -126,21 +118,16 @@ void ProjectPage::setManualStartSubBooklet(bool value)
  ************************************************/
 void ProjectPage::setAutoStartSubBooklet(bool value)
 {
-    mAutoStartSubBooklet = value;
+    pageTable->setFlag(mRow, PageTable::AutoStartSubBooklet, value);
 }
 
 
 /************************************************
  *
  ************************************************/
-ProjectPage *ProjectPage::clone(QObject *parent)
+ProjectPage *ProjectPage::clone() const
 {
-    ProjectPage *res = new ProjectPage(parent);
-    res->mJobPageNum = mJobPageNum;
-    res->mPdfInfo = mPdfInfo;
-    res->setVisible(mVisible);
-    res->setManualRotation(mManualRotation);
-    res->setManualStartSubBooklet(mManualStartSubBooklet);
+    ProjectPage *res = new ProjectPage();
+    pageTable->copyRow(mRow, res->mRow);
     return res;
 }
-
@@ -27,48 +27,54 @@
 #ifndef PROJECTPAGE_H
 #define PROJECTPAGE_H
 
-#include <QObject>
 #include <QRectF>
 #include "boomagatypes.h"
+#include "pagetable.h"
 
 class Sheet;
 
-class ProjectPage : public QObject
+/************************************************
+ * The ProjectPage is a handle to the row of the PageTable.
+ ************************************************/
+class ProjectPage
 {
-    Q_OBJECT
     friend class Project;
+    friend class ProjectPagePointer;
 public:
-    explicit ProjectPage(QObject *parent = 0);
-    explicit ProjectPage(int jobPageNum, QObject *parent = 0);
+    ProjectPage();
+    explicit ProjectPage(int jobPageNum);
     virtual ~ProjectPage();
 
-    int jobPageNum() const { return mJobPageNum; }
+    int jobPageNum() const { return pageTable->jobPageNum(mRow); }
     int pageNum() const { return mPageNum; }
     Sheet *sheet() const { return mSheet; }
 
     virtual QRectF rect() const;
     Rotation pdfRotation() const;
-    Rotation manualRotation() const { return mManualRotation; }
-    void setManualRotation(Rotation value) { mManualRotation = value; }
+    Rotation manualRotation() const { return pageTable->manualRotation(mRow); }
+    void setManualRotation(Rotation value) { pageTable->setManualRotation(mRow, value); }
 
-    PdfPageInfo pdfInfo() const { return mPdfInfo; }
-    void setPdfInfo(const PdfPageInfo &value) { mPdfInfo = value; }
+    PdfPageInfo pdfInfo() const { return pageTable->pdfInfo(mRow); }
+    void setPdfInfo(const PdfPageInfo &value) { pageTable->setPdfInfo(mRow, value); }
 
-    bool visible() const { return mVisible;}
+    int  xObjCount() const { return pageTable->xObjCount(mRow); }
+    uint xObjNum(int index) const { return pageTable->xObjNum(mRow, index); }
+
+    bool visible() const { return pageTable->flag(mRow, PageTable::Visible); }
     void setVisible(bool value);
     void hide() { setVisible(false); }
     void show() { setVisible(true); }
 
     bool isBlankPage() const;
 
-    bool isStartSubBooklet() const { return mManualStartSubBooklet || mAutoStartSubBooklet; }
-    bool isManualStartSubBooklet() const { return mManualStartSubBooklet; }
+    bool isStartSubBooklet() const { return isManualStartSubBooklet() || isAutoStartSubBooklet(); }
+    bool isManualStartSubBooklet() const { return pageTable->flag(mRow, PageTable::ManualStartSubBooklet); }
     void setManualStartSubBooklet(bool value);
-    bool isAutoStartSubBooklet() const { return mAutoStartSubBooklet; }
+    bool isAutoStartSubBooklet() const { return pageTable->flag(mRow, PageTable::AutoStartSubBooklet); }
     void setAutoStartSubBooklet(bool value);
 
 
-    ProjectPage *clone(QObject *parent = 0);
+    ProjectPage *clone() const;
 
 protected:
     void setPageNum(int pageNum) { mPageNum = pageNum; }
@@ -76,14 +82,43 @@ protected:
 
 private:
     Q_DISABLE_COPY(ProjectPage)
-    int mJobPageNum;
+    PageTable::Row mRow;
     int mPageNum;
     Sheet *mSheet;
-    bool mVisible;
-    PdfPageInfo mPdfInfo;
-    Rotation mManualRotation;
-    bool mManualStartSubBooklet;
-    bool mAutoStartSubBooklet;
+};
+
+
+/************************************************
+ * Refers to the page without owning it, like QPointer
+ * does for QObjects. It becomes null when the page is
+ * deleted, even if a new page is allocated at the same
+ * address, as the released row gets a new generation.
+ ************************************************/
+class ProjectPagePointer
+{
+public:
+    ProjectPagePointer(ProjectPage *page = 0) { *this = page; }
+
+    ProjectPagePointer &operator=(ProjectPage *page)
+    {
+        mPage = page;
+        mRow = page ? page->mRow : -1;
+        mGeneration = page ? pageTable->generation(mRow) : 0;
+        return *this;
+    }
+
+    ProjectPage *data() const
+    {
+        return (mPage && pageTable->generation(mRow) == mGeneration) ? mPage : 0;
+    }
+
+    operator ProjectPage*() const { return data(); }
+    ProjectPage *operator->() const { return data(); }
+
+private:
+    ProjectPage *mPage;
+    PageTable::Row mRow;
+    quint32 mGeneration;
 };
 
 #endif // PROJECTPAGE_H
@@ -0,0 +1,279 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#include "segmentfile.h"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#define SEGMENT_SIZE (8 * 1024 * 1024)
+
+
+/************************************************
+ *
+ ************************************************/
+SegmentFile::SegmentFile(const QString &fileName, QObject *parent):
+    QIODevice(parent),
+    mFileName(fileName),
+    mFd(-1),
+    mBufPos(0),
+    mFileSize(0),
+    mSyncedPos(0),
+    mDropCache(false)
+{
+}
+
+
+/************************************************
+ *
+ ************************************************/
+SegmentFile::~SegmentFile()
+{
+    close();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+bool SegmentFile::open(QIODevice::OpenMode mode)
+{
+    if (isOpen())
+        close();
+
+    int flags = O_CREAT | O_CLOEXEC;
+    flags |= (mode & ReadOnly) ? O_RDWR : O_WRONLY;
+    if (mode & Truncate)
+        flags |= O_TRUNC;
+
+    mFd = ::open(mFileName.toLocal8Bit().constData(), flags, 0600);
+    if (mFd < 0)
+    {
+        setErrorString(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+
+    struct stat st;
+    mFileSize = (fstat(mFd, &st) == 0) ? st.st_size : 0;
+    mBufPos = 0;
+    mSyncedPos = 0;
+    mBuf.reserve(SEGMENT_SIZE);
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(mFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    return QIODevice::open(mode | Unbuffered);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void SegmentFile::close()
+{
+    if (mFd < 0)
+        return;
+
+    flush();
+    QIODevice::close();
+    ::close(mFd);
+    mFd = -1;
+    mBuf.clear();
+    mBuf.squeeze();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+qint64 SegmentFile::size() const
+{
+    return qMax(mFileSize, mBufPos + mBuf.size());
+}
+
+
+/************************************************
+ *
+ ************************************************/
+bool SegmentFile::seek(qint64 pos)
+{
+    if (!flush())
+        return false;
+
+    mSyncedPos = qMin(mSyncedPos, pos - pos % SEGMENT_SIZE);
+    return QIODevice::seek(pos);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+bool SegmentFile::flush()
+{
+    if (mBuf.isEmpty())
+        return true;
+
+    bool res = writeAt(mBuf.constData(), mBuf.size(), mBufPos);
+    mBuf.resize(0);
+    return res;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+bool SegmentFile::resize(qint64 size)
+{
+    if (!flush())
+        return false;
+
+    if (ftruncate(mFd, size) != 0)
+    {
+        setErrorString(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+
+    mFileSize = size;
+    mSyncedPos = qMin(mSyncedPos, size - size % SEGMENT_SIZE);
+    return true;
+}
+
+
+/************************************************
+ * FALLOC_FL_KEEP_SIZE leaves the file size as is, so
+ * the readers never see the preallocated zeros.
+ ************************************************/
+bool SegmentFile::preallocate(qint64 size)
+{
+    if (mFd < 0 || size <= mFileSize)
+        return false;
+
+#ifdef Q_OS_LINUX
+    return fallocate(mFd, FALLOC_FL_KEEP_SIZE, 0, size) == 0;
+#else
+    return false;
+#endif
+}
+
+
+/************************************************
+ *
+ ************************************************/
+qint64 SegmentFile::readData(char *data, qint64 maxSize)
+{
+    if (!flush())
+        return -1;
+
+    qint64 res = pread(mFd, data, maxSize, pos());
+    if (res < 0)
+        setErrorString(QString::fromLocal8Bit(strerror(errno)));
+
+    return res;
+}
+
+
+/************************************************
+ * The position is advanced by QIODevice, the data is
+ * written to the file when the segment is full.
+ ************************************************/
+qint64 SegmentFile::writeData(const char *data, qint64 len)
+{
+    if (mBuf.isEmpty())
+        mBufPos = pos();
+
+    if (mBuf.size() + len > SEGMENT_SIZE)
+    {
+        if (!flush())
+            return -1;
+
+        mBufPos = pos();
+    }
+
+    if (len >= SEGMENT_SIZE)
+        return writeAt(data, len, mBufPos) ? len : -1;
+
+    mBuf.append(data, len);
+    return len;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+bool SegmentFile::writeAt(const char *data, qint64 len, qint64 pos)
+{
+    qint64 done = 0;
+    while (done < len)
+    {
+        ssize_t n = pwrite(mFd, data + done, len - done, pos + done);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            setErrorString(QString::fromLocal8Bit(strerror(errno)));
+            return false;
+        }
+        done += n;
+    }
+
+    mFileSize = qMax(mFileSize, pos + len);
+    segmentWritten(pos + len);
+    return true;
+}
+
+
+/************************************************
+ * Starts the writeback of each finished segment, so
+ * the dirty pages don't pile up until close. With
+ * dropCache, the segment before it is waited for and
+ * dropped from the page cache.
+ ************************************************/
+void SegmentFile::segmentWritten(qint64 end)
+{
+#ifdef Q_OS_LINUX
+    while (end - mSyncedPos >= SEGMENT_SIZE)
+    {
+        sync_file_range(mFd, mSyncedPos, SEGMENT_SIZE, SYNC_FILE_RANGE_WRITE);
+
+        if (mDropCache && mSyncedPos >= SEGMENT_SIZE)
+        {
+            qint64 prev = mSyncedPos - SEGMENT_SIZE;
+            sync_file_range(mFd, prev, SEGMENT_SIZE,
+                            SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+            posix_fadvise(mFd, prev, SEGMENT_SIZE, POSIX_FADV_DONTNEED);
+        }
+
+        mSyncedPos += SEGMENT_SIZE;
+    }
+#else
+    Q_UNUSED(end);
+#endif
+}
@@ -0,0 +1,86 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#ifndef SEGMENTFILE_H
+#define SEGMENTFILE_H
+
+#include <QIODevice>
+#include <QString>
+
+/// The SegmentFile class writes a large file with pwrite(2), one segment at a time.
+///
+/// The data is collected in a segment sized buffer, the pages of the finished
+/// segments are sent to the disk in the background. When dropCache is enabled,
+/// the pages that are already on the disk are removed from the page cache, so
+/// writing a file that is larger than RAM doesn't push out the rest of the cache.
+class SegmentFile: public QIODevice
+{
+    Q_OBJECT
+public:
+    explicit SegmentFile(const QString &fileName, QObject *parent = 0);
+    virtual ~SegmentFile();
+
+    QString fileName() const { return mFileName; }
+
+    bool open(OpenMode mode) override;
+    void close() override;
+
+    bool isSequential() const override { return false; }
+    qint64 size() const override;
+    bool seek(qint64 pos) override;
+
+    /// Writes the buffered data to the file.
+    bool flush();
+
+    /// Changes the file size, the data after size is discarded.
+    bool resize(qint64 size);
+
+    /// Reserves the disk blocks for the first size bytes, the file size is not
+    /// changed. It's only an optimization, so false is returned if the file
+    /// system doesn't support it.
+    bool preallocate(qint64 size);
+
+    bool dropCache() const { return mDropCache; }
+    void setDropCache(bool value) { mDropCache = value; }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    bool writeAt(const char *data, qint64 len, qint64 pos);
+    void segmentWritten(qint64 end);
+
+    QString mFileName;
+    int mFd;
+    QByteArray mBuf;
+    qint64 mBufPos;
+    qint64 mFileSize;
+    qint64 mSyncedPos;
+    bool mDropCache;
+};
+
+#endif // SEGMENTFILE_H
@@ -136,6 +136,10 @@ void Sheet::setHint(const Sheet::Hint &hint, bool enable)
  ************************************************/
 int SheetList::indexOfPage(const ProjectPage *page, int from) const
 {
+    int n = mIndex.value(page, -1);
+    if (n >= from && n < count() && at(n)->indexOfPage(page) > -1)
+        return n;
+
     for (int i=from; i<count(); ++i)
     {
         const Sheet *sheet = at(i);
@@ -158,6 +162,26 @@ int  SheetList::indexOfPage(int pageNum, int from) const
 }
 
 
+/************************************************
+ *
+ ************************************************/
+void SheetList::updateIndex()
+{
+    mIndex.clear();
+    mIndex.reserve(count() * 2);
+
+    for (int i=count()-1; i>=0; --i)
+    {
+        const Sheet *sheet = at(i);
+        for (int p=0; p<sheet->count(); ++p)
+        {
+            if (sheet->page(p))
+                mIndex.insert(sheet->page(p), i);
+        }
+    }
+}
+
+
 /************************************************
  *
  ************************************************/
@@ -29,6 +29,7 @@
 
 #include <QtGlobal>
 #include <QVector>
+#include <QHash>
 #include <QRectF>
 #include <QDebug>
 #include "boomagatypes.h"
@@ -81,6 +82,16 @@ class SheetList: public QList<Sheet*>
 public:
     int indexOfPage(const ProjectPage *page, int from = 0) const;
     int indexOfPage(int pageNum, int from = 0) const;
+
+    /// Rebuilds the page-to-sheet index used by indexOfPage.
+    /// The lookups stay correct if the list is changed later,
+    /// but they fall back to the linear search until the next call.
+    /// A stale entry is checked against its sheet only, so this holds
+    /// as long as a page is placed on one sheet of the list.
+    void updateIndex();
+
+private:
+    QHash<const ProjectPage*, int> mIndex;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(Sheet::Hints)
@@ -24,20 +24,31 @@
  * END_COMMON_COPYRIGHT_HEADER */
 
 #include "tmppdffile.h"
+#include "segmentfile.h"
 #include <QCryptographicHash>
+#include <QFileInfo>
+#include <QDataStream>
 #include <QDir>
 #include <cmath>
 #include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <unistd.h>
 
 #include "sheet.h"
 #include "layout.h"
 #include "pdfprocessor.h"
 #include "pdfparser/pdfwriter.h"
 #include "pdfparser/pdfobject.h"
+#include "pdfparser/pdfmappedfile.h"
 #include "projectpage.h"
 #include "printer.h"
 #include "project.h"
 
+// Larger files are dropped from the page cache as they are written.
+#define DROP_CACHE_SIZE (Q_INT64_C(1024) * 1024 * 1024)
+#define COPY_CHUNK_SIZE (1024 * 1024)
+
 
 /************************************************
 
@@ -71,6 +82,7 @@ TmpPdfFile::TmpPdfFile(QObject *parent):
     mFirstFreeNum = 0;
 
     mFileName = genTmpFileName(".tmp");
+    mFile = new SegmentFile(mFileName, this);
 }
 
 
@@ -79,6 +91,7 @@ TmpPdfFile::TmpPdfFile(QObject *parent):
  ************************************************/
 TmpPdfFile::~TmpPdfFile()
 {
+    mFile->close();
     QFile::remove(mFileName);
 }
 
@@ -88,39 +101,80 @@ TmpPdfFile::~TmpPdfFile()
  ************************************************/
 void TmpPdfFile::merge(const JobList &jobs)
 {
-    QFile file(mFileName);
-    if (! file.open(QFile::WriteOnly | QFile::Truncate))
+    mValid = false;
+    if (! mFile->open(QIODevice::ReadWrite | QIODevice::Truncate))
     {
         throw BoomagaError(tr("I can't write file \"%1\"")
-                           .arg(file.fileName())
-                           + "\n" + file.errorString());
+                           .arg(mFileName)
+                           + "\n" + mFile->errorString());
     }
 
     try
     {
-        PDF::Writer writer(&file);
+        PDF::Writer writer(mFile);
         writer.writePDFHeader(1,7);
 
+        // The copies of the CUPS job point to the same part of the same
+        // file, such jobs share one processor and it's written only once.
         QVector<PdfProcessor*> procs;
         procs.reserve(jobs.count());
+        QHash<QString, PdfProcessor*> uniqProcs;
 
         quint32 pagesCnt = 0;
+        qint64 estimatedSize = 0;
         foreach (const Job &job, jobs)
         {
-            auto proc = new PdfProcessor(job.fileName(), job.fileStartPos(), job.fileEndPos());
-            proc->open();
-            pagesCnt += proc->pageCount();
+            // The PostScript job is still converted, it has only
+            // the placeholder pages without the PDF data.
+            if (job.state() != Job::JobReady)
+            {
+                procs << nullptr;
+                continue;
+            }
+
+            QString key = QString("%1:%2:%3")
+                    .arg(job.fileName())
+                    .arg(job.fileStartPos())
+                    .arg(job.fileEndPos());
+
+            PdfProcessor *proc = uniqProcs.value(key);
+            if (!proc)
+            {
+                proc = new PdfProcessor(job.fileName(), job.fileStartPos(), job.fileEndPos());
+                uniqProcs.insert(key, proc);
+                proc->open();
+                pagesCnt += proc->pageCount();
+
+                qint64 end = job.fileEndPos() ? job.fileEndPos() : QFileInfo(job.fileName()).size();
+                estimatedSize += end - job.fileStartPos();
+            }
             procs << proc;
         }
 
+        // The merged file is about as large as the sum of the source
+        // parts, reserving it at once avoids growing the file in steps.
+        mFile->preallocate(estimatedSize);
+        mFile->setDropCache(estimatedSize > DROP_CACHE_SIZE);
+
 
         QVector<PdfPageInfo> pages;
+        QSet<PdfProcessor*> written;
 
         int ready =0;
         for (int i=0; i<jobs.count(); ++i)
         {
             const Job &job = jobs.at(i);
             PdfProcessor *proc = procs.at(i);
+            if (!proc)
+                continue;
+
+            if (written.contains(proc))
+            {
+                setPagesInfo(job, proc);
+                pages << proc->pageInfo();
+                continue;
+            }
+            written << proc;
 
             QDateTime prevEmit;
             connect(proc, &PdfProcessor::pageReady, [this, &ready, pagesCnt, &prevEmit] ()
@@ -137,26 +191,18 @@ void TmpPdfFile::merge(const JobList &jobs)
             });
 
             proc->run(&writer, writer.xRefTable().maxObjNum() + 3);
-
-            for (int p=0; p<job.pageCount(); ++p)
-            {
-                ProjectPage *page = job.page(p);
-                if (page->jobPageNum() < 0)
-                    continue;
-
-                if (page->jobPageNum() >= proc->pageInfo().count())
-                    continue;
-
-                page->setPdfInfo(proc->pageInfo().at(page->jobPageNum()));
-
-            }
-
+            setPagesInfo(job, proc);
             pages << proc->pageInfo();
         }
-        qDeleteAll(procs);
+        qDeleteAll(uniqProcs);
 
         writeCatalog(&writer, pages);
-        file.close();
+        if (!mFile->flush())
+        {
+            throw BoomagaError(tr("I can't write file \"%1\"")
+                               .arg(mFileName)
+                               + "\n" + mFile->errorString());
+        }
         mValid = true;
 
     }
@@ -169,6 +215,25 @@ void TmpPdfFile::merge(const JobList &jobs)
 }
 
 
+/************************************************
+ *
+ ************************************************/
+void TmpPdfFile::setPagesInfo(const Job &job, const PdfProcessor *proc)
+{
+    for (int p=0; p<job.pageCount(); ++p)
+    {
+        ProjectPage *page = job.page(p);
+        if (page->jobPageNum() < 0)
+            continue;
+
+        if (page->jobPageNum() >= proc->pageInfo().count())
+            continue;
+
+        page->setPdfInfo(proc->pageInfo().at(page->jobPageNum()));
+    }
+}
+
+
 /************************************************
  *
  ************************************************/
@@ -283,20 +348,71 @@ void TmpPdfFile::updateSheets(const QList<Sheet *> &sheets)
 {
     if (mValid)
     {
-        QFile file(mFileName);
-        if (!file.open(QFile::ReadWrite))
+        // The file stays open after merge, only the tail is rewritten.
+        mFile->seek(mOrigFileSize);
+        writeSheets(mFile, sheets);
+
+        if (!mFile->resize(mFile->pos()))
         {
             project->error(tr("I can't create temporary file \"%1\"")
-                           .arg(mFileName));
-            return;
+                           .arg(mFileName)
+                           + "\n" + mFile->errorString());
         }
-        file.seek(mOrigFileSize);
+   }
+}
 
-        writeSheets(&file, sheets);
 
-        file.resize(file.pos());
-        file.close();
-   }
+/************************************************
+ *
+ ************************************************/
+void TmpPdfFile::writeState(QDataStream &out) const
+{
+    out << mFileName
+        << mOrigFileSize
+        << mOrigXrefPos
+        << mFirstFreeNum;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+bool TmpPdfFile::readState(QDataStream &in)
+{
+    QString fileName;
+    in >> fileName
+       >> mOrigFileSize
+       >> mOrigXrefPos
+       >> mFirstFreeNum;
+
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    if (QFileInfo(fileName).size() < mOrigFileSize)
+        return false;
+
+    // The file is linked, not renamed, so the process that wrote
+    // the state still has it until it's sure the file was taken.
+    QFile::remove(mFileName);
+    if (::link(QFile::encodeName(fileName).constData(), QFile::encodeName(mFileName).constData()) != 0)
+        return false;
+
+    // Only the sheets after the original part are rewritten.
+    if (!mFile->open(QIODevice::ReadWrite))
+        return false;
+
+    mValid = true;
+    return true;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void TmpPdfFile::release()
+{
+    mFile->close();
+    mValid = false;
 }
 
 
@@ -305,19 +421,25 @@ void TmpPdfFile::updateSheets(const QList<Sheet *> &sheets)
  ************************************************/
 bool TmpPdfFile::writeDocument(const QList<Sheet*> &sheets, QIODevice *out)
 {
-    QFile f(mFileName);
-    if (!f.open(QFile::ReadOnly))
-        return project->error(tr("I can't read file '%1'").arg(mFileName) + "\n" + out->errorString());
+    // Only the original part is copied, the old sheets are not even mapped.
+    qint64 size = qMin(mOrigFileSize, QFileInfo(mFileName).size());
+    PDF::MappedFile file;
+    try
+    {
+        file = PDF::MappedFile(mFileName, 0, size);
+    }
+    catch (PDF::Error &err)
+    {
+        return project->error(tr("I can't read file '%1'").arg(mFileName) + "\n" + err.what());
+    }
 
+    file.advise(PDF::MappedFile::SequentialAccess);
 
-    qint64 bufLen = qMin(mOrigFileSize - f.pos(), (qint64)(1024 * 1024));
-    while (bufLen > 0)
+    for (qint64 pos = 0; pos < size; pos += COPY_CHUNK_SIZE)
     {
-        int wrote = out->write(f.read(bufLen));
-        if (wrote<0)
+        qint64 len = qMin(size - pos, qint64(COPY_CHUNK_SIZE));
+        if (out->write(file.data() + pos, len) != len)
             return project->error(tr("I can't write to file '%1'").arg(mFileName) + "\n" + out->errorString());
-
-        bufLen = qMin(mOrigFileSize - f.pos(), (qint64)(1024 * 1024));
     }
 
     writeSheets(out, sheets);
@@ -386,9 +508,9 @@ void TmpPdfFile::writeSheets(QIODevice *out, const QList<Sheet *> &sheets) const
             if (!page)
                 continue;
 
-            for (int j=0; j<page->pdfInfo().xObjNums.count(); ++j)
+            for (int j=0; j<page->xObjCount(); ++j)
             {
-                *out << "/Im" << i << "_" << j << " " << page->pdfInfo().xObjNums.at(j) <<  " 0 R ";
+                *out << "/Im" << i << "_" << j << " " << page->xObjNum(j) <<  " 0 R ";
             }
         }
         *out << ">>\n";
@@ -566,7 +688,7 @@ void TmpPdfFile::getPageStream(QString *out, const Sheet *sheet) const
                     .arg(-rect.top(), 0, 'f', 3);
 
 
-            for (int j=0; j<page->pdfInfo().xObjNums.size(); ++j)
+            for (int j=0; j<page->xObjCount(); ++j)
                 *out += QString("/Im%1_%2 Do\n").arg(i).arg(j);
 
 
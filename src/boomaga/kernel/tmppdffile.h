@@ -34,6 +34,9 @@
 class Sheet;
 class Job;
 class JobList;
+class PdfProcessor;
+class SegmentFile;
+class QDataStream;
 
 namespace PDF {
     class Writer;
@@ -57,6 +60,18 @@ public:
     bool writeDocument(const QList<Sheet*> &sheets, QIODevice *out);
     bool isValid() const { return mValid; }
 
+    /// Writes what another process needs to use the merged file
+    /// without merging the jobs again.
+    void writeState(QDataStream &out) const;
+
+    /// Takes over the merged file described by writeState(). The file is
+    /// linked under the name of this object. Returns false on error.
+    bool readState(QDataStream &in);
+
+    /// Closes the file without writing to it anymore. Once another process
+    /// took the file with readState(), both share its data.
+    void release();
+
 signals:
     void merged();
     void progress(int progress, int all) const;
@@ -64,9 +79,11 @@ signals:
 private:
     void getPageStream(QString *out, const Sheet *sheet) const;
     void writeSheets(QIODevice *out, const QList<Sheet *> &sheets) const;
+    void setPagesInfo(const Job &job, const PdfProcessor *proc);
     void writeCatalog(PDF::Writer *writer, const QVector<PdfPageInfo> &pages);
 
     QString mFileName;
+    SegmentFile *mFile;
     qint32 mFirstFreeNum;
     qint64 mOrigFileSize;
     qint64 mOrigXrefPos;
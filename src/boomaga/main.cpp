@@ -27,6 +27,8 @@
 #include "kernel/project.h"
 #include "gui/mainwindow.h"
 #include "dbus.h"
+#include "spoolwatcher.h"
+#include "service.h"
 #include "kernel/job.h"
 #include "../common.h"
 
@@ -36,6 +38,7 @@
 #include <QTranslator>
 #include <QDBusConnection>
 #include <QFileInfo>
+#include <QLocalSocket>
 #include <QLibraryInfo>
 #include <QDebug>
 #include <QFile>
@@ -55,6 +58,7 @@ struct Args
     Args(int argc, char *argv[]);
 
     bool startedFromCups;
+    bool service;
     stringList files;
 };
 
@@ -75,6 +79,8 @@ void printHelp()
     out << "Options:" << endl;
     out << "  -h, --help              Show help about options" << endl;
     out << "  -V, --version           Print program version" << endl;
+    out << "  --service               Run without GUI, collect the print jobs" << endl;
+    out << "                          until the GUI is started" << endl;
     out << endl;
 
     out << "Arguments:" << endl;
@@ -110,7 +116,8 @@ int printError(const QString &msg)
  *
  ************************************************/
 Args::Args(int argc, char *argv[]):
-    startedFromCups(false)
+    startedFromCups(false),
+    service(false)
 {
     for (int i = 1; i<argc; ++i)
     {
@@ -138,6 +145,13 @@ Args::Args(int argc, char *argv[]):
             continue;
         }
 
+        //*************************************************
+        if (arg == "--service")
+        {
+            service = true;
+            continue;
+        }
+
         //*************************************************
         files.push_back(argv[i]);
     }
@@ -214,6 +228,20 @@ int main(int argc, char *argv[])
         return 0;
     }
 
+    // Start service ............................
+    if (args.service)
+    {
+        if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+
+        QApplication application(argc, argv);
+        QObject::connect(&application, &QCoreApplication::aboutToQuit,
+                         &cleanup);
+
+        BoomagaService service;
+        return application.exec();
+    }
+
     // Start GUI ................................
     readEnvFile();
 
@@ -232,8 +260,17 @@ int main(int argc, char *argv[])
     application.installTranslator(&translator);
 
 
+    // Take the jobs collected by the service before we register on D-Bus.
+    QLocalSocket serviceSocket;
+    QString serviceFile = BoomagaService::attach(&serviceSocket);
+
     BoomagaDbus dbus("org.boomaga", "/boomaga");
 
+    SpoolWatcher spoolWatcher;
+    spoolWatcher.addDir(SpoolWatcher::defaultDir());
+    QObject::connect(&dbus, &BoomagaDbus::fileReceived,
+                     &spoolWatcher, &SpoolWatcher::load);
+
     MainWindow mainWindow;
     mainWindow.show();
     application.processEvents();
@@ -250,6 +287,36 @@ int main(int argc, char *argv[])
         files << QString::fromStdString(f);
     }
 
-    project->load(files);
+    // The merged file of the service is used as is, the project
+    // file is only requested if the merged state can't be read.
+    // The service removes its files and jobs when we confirm.
+    bool takeService = false;
+    if (!serviceFile.isEmpty())
+    {
+        QString mergedFile = BoomagaService::mergedFileName(serviceFile);
+        if (QFile::exists(mergedFile) && project->loadMerged(mergedFile))
+        {
+            serviceFile.clear();
+            takeService = true;
+        }
+        else
+        {
+            if (!QFile::exists(serviceFile))
+                serviceFile = BoomagaService::requestProjectFile(&serviceSocket);
+
+            serviceFile = BoomagaService::takeProjectFile(serviceFile);
+            takeService = !serviceFile.isEmpty();
+        }
+    }
+
+    if (!serviceFile.isEmpty())
+        files.prepend(serviceFile);
+
+    if (!files.isEmpty())
+        project->load(files);
+
+    if (takeService)
+        BoomagaService::confirm(&serviceSocket);
+
     return application.exec();
 }
@@ -0,0 +1,318 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2012-2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#include "pdfmappedfile.h"
+#include "pdferrors.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QFile>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <utility>
+
+namespace PDF {
+struct MappedFileEntry
+{
+    QString key;
+    QString fileName;
+    dev_t   dev;
+    ino_t   ino;
+    off_t   fileSize;
+    qint64  mtime;
+    quint64 offset;
+    quint64 size;
+    const char *data;
+    void   *mapAddr;
+    size_t  mapLen;
+    int     ref;
+};
+} // namespace PDF
+
+using namespace PDF;
+
+static QMutex &registryMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+static QHash<QString, MappedFileEntry*> &registry()
+{
+    static QHash<QString, MappedFileEntry*> hash;
+    return hash;
+}
+
+static qint64 mtimeNs(const struct stat &st)
+{
+    return qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+static QString errorString()
+{
+    return QString::fromLocal8Bit(strerror(errno));
+}
+
+
+/************************************************
+ *
+ ************************************************/
+MappedFile::MappedFile():
+    mEntry(nullptr)
+{
+}
+
+
+/************************************************
+ *
+ ************************************************/
+MappedFile::MappedFile(const QString &fileName):
+    mEntry(nullptr)
+{
+    map(fileName, 0, 0, true);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+MappedFile::MappedFile(const QString &fileName, quint64 pos, quint64 len):
+    mEntry(nullptr)
+{
+    map(fileName, pos, len, false);
+}
+
+
+/************************************************
+ * mmap requires the page aligned offset, so the
+ * window is extended to the page boundary.
+ ************************************************/
+void MappedFile::map(const QString &fileName, quint64 pos, quint64 len, bool whole)
+{
+    QByteArray path = QFile::encodeName(fileName);
+    QMutexLocker locker(&registryMutex());
+
+    int fd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw Error(QString("I can't open file \"%1\":%2").arg(fileName).arg(errorString()));
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        QString err = errorString();
+        ::close(fd);
+        throw Error(QString("I can't open file \"%1\":%2").arg(fileName).arg(err));
+    }
+
+    quint64 fileSize = st.st_size;
+    if (whole || (!len && pos <= fileSize))
+        len = fileSize - pos;
+
+    if (pos > fileSize || len > fileSize - pos)
+    {
+        ::close(fd);
+        throw Error(QString("I can't map %1 bytes at %2 of file \"%3\", the file size is %4.")
+                    .arg(len)
+                    .arg(pos)
+                    .arg(fileName)
+                    .arg(fileSize));
+    }
+
+    QString key = whole ? fileName : QString("%1:%2:%3").arg(fileName).arg(pos).arg(len);
+
+    MappedFileEntry *entry = registry().value(key);
+    if (entry &&
+        entry->dev      == st.st_dev  &&
+        entry->ino      == st.st_ino  &&
+        entry->fileSize == st.st_size &&
+        entry->mtime    == mtimeNs(st))
+    {
+        ::close(fd);
+        ++entry->ref;
+        mEntry = entry;
+        return;
+    }
+
+    static const quint64 pageSize = sysconf(_SC_PAGESIZE);
+    quint64 mapStart = pos - pos % pageSize;
+    size_t  mapLen   = len + (pos - mapStart);
+
+    void *addr = nullptr;
+    if (len > 0)
+    {
+        addr = mmap(nullptr, mapLen, PROT_READ, MAP_SHARED, fd, mapStart);
+        if (addr == MAP_FAILED)
+        {
+            QString err = errorString();
+            ::close(fd);
+            throw Error(QString("I can't map file \"%1\":%2").arg(fileName).arg(err));
+        }
+    }
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+
+    mEntry = new MappedFileEntry();
+    mEntry->key      = key;
+    mEntry->fileName = fileName;
+    mEntry->dev      = st.st_dev;
+    mEntry->ino      = st.st_ino;
+    mEntry->fileSize = st.st_size;
+    mEntry->mtime    = mtimeNs(st);
+    mEntry->offset   = pos;
+    mEntry->size     = len;
+    mEntry->mapAddr  = addr;
+    mEntry->mapLen   = addr ? mapLen : 0;
+    mEntry->data     = addr ? static_cast<const char*>(addr) + (pos - mapStart) : nullptr;
+    mEntry->ref      = 1;
+
+    // The outdated entry is removed from the registry,
+    // but it stays mapped while somebody uses it.
+    registry().insert(key, mEntry);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+MappedFile::MappedFile(const MappedFile &other):
+    mEntry(other.mEntry)
+{
+    if (mEntry)
+    {
+        QMutexLocker locker(&registryMutex());
+        ++mEntry->ref;
+    }
+}
+
+
+/************************************************
+ *
+ ************************************************/
+MappedFile &MappedFile::operator=(const MappedFile &other)
+{
+    if (mEntry == other.mEntry)
+        return *this;
+
+    MappedFile tmp(other);
+    std::swap(mEntry, tmp.mEntry);
+    return *this;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+MappedFile::~MappedFile()
+{
+    if (!mEntry)
+        return;
+
+    QMutexLocker locker(&registryMutex());
+    if (--mEntry->ref)
+        return;
+
+    if (registry().value(mEntry->key) == mEntry)
+        registry().remove(mEntry->key);
+
+    if (mEntry->mapAddr)
+        munmap(mEntry->mapAddr, mEntry->mapLen);
+
+    delete mEntry;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QString MappedFile::fileName() const
+{
+    return mEntry ? mEntry->fileName : QString();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+const char *MappedFile::data() const
+{
+    return mEntry ? mEntry->data : nullptr;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+quint64 MappedFile::size() const
+{
+    return mEntry ? mEntry->size : 0;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+quint64 MappedFile::offset() const
+{
+    return mEntry ? mEntry->offset : 0;
+}
+
+
+/************************************************
+ * madvise requires a page aligned address, so the
+ * range is extended to the page boundary.
+ ************************************************/
+void MappedFile::advise(MappedFile::Advice advice, quint64 pos, quint64 len) const
+{
+    if (!mEntry || !mEntry->data || pos >= mEntry->size)
+        return;
+
+    if (!len || pos + len > mEntry->size)
+        len = mEntry->size - pos;
+
+    // The position in the mapping, which starts at the page boundary.
+    pos += mEntry->data - static_cast<const char*>(mEntry->mapAddr);
+
+    static const quint64 pageSize = sysconf(_SC_PAGESIZE);
+    quint64 start = pos - pos % pageSize;
+    len += pos - start;
+
+    int flag = MADV_NORMAL;
+    switch (advice)
+    {
+    case NormalAccess:     flag = MADV_NORMAL;     break;
+    case SequentialAccess: flag = MADV_SEQUENTIAL; break;
+    case RandomAccess:     flag = MADV_RANDOM;     break;
+    case WillNeed:         flag = MADV_WILLNEED;   break;
+    }
+
+    // It's only a hint, so errors are ignored.
+    madvise(static_cast<char*>(mEntry->mapAddr) + start, len, flag);
+}
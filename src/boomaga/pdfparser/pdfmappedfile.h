@@ -0,0 +1,95 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2012-2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#ifndef PDFMAPPEDFILE_H
+#define PDFMAPPEDFILE_H
+
+#include <QtGlobal>
+#include <QString>
+
+namespace PDF {
+
+struct MappedFileEntry;
+
+/// The PDF::MappedFile class provides a shared read-only memory mapping of the file,
+/// or of the window of it.
+///
+/// All MappedFile objects for the same window of the unchanged file share one mapping,
+/// which is removed when the last of them is destroyed. If the file was modified since
+/// it was mapped (size, mtime or inode differ), a new mapping is created, the objects
+/// that still refer the old one keep it alive.
+class MappedFile
+{
+public:
+    /// Access patterns passed to madvise(2).
+    enum Advice
+    {
+        NormalAccess,
+        SequentialAccess,
+        RandomAccess,
+        WillNeed
+    };
+
+    /// Constructs a null MappedFile.
+    MappedFile();
+
+    /// Maps the whole file, or shares an existing mapping of it.
+    /// Throws PDF::Error if the file can't be opened or mapped.
+    explicit MappedFile(const QString &fileName);
+
+    /// Maps only len bytes of the file starting at position pos, so a small part
+    /// of a large file doesn't take the address space of the whole file. If len
+    /// is 0, the window ends at the end of the file. data() points to the byte at
+    /// pos. Throws PDF::Error if the window is beyond the end of the file.
+    MappedFile(const QString &fileName, quint64 pos, quint64 len);
+
+    MappedFile(const MappedFile &other);
+    MappedFile &operator=(const MappedFile &other);
+    ~MappedFile();
+
+    bool isNull() const { return !mEntry; }
+    QString fileName() const;
+
+    const char *data() const;
+    quint64 size() const;
+
+    /// The position of data() in the file.
+    quint64 offset() const;
+
+    /// Gives the kernel a hint about how the len bytes starting at pos will be used.
+    /// The pos is relative to data(). If len is 0, the hint is applied to everything
+    /// after pos.
+    void advise(Advice advice, quint64 pos = 0, quint64 len = 0) const;
+
+private:
+    MappedFileEntry *mEntry;
+
+    void map(const QString &fileName, quint64 pos, quint64 len, bool whole);
+};
+
+} // namespace PDF
+
+#endif // PDFMAPPEDFILE_H
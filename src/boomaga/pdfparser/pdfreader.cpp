@@ -31,8 +31,17 @@
 #include "pdfobject.h"
 #include "pdferrors.h"
 #include "pdfvalue.h"
+#include "pdfscan.h"
 #include <QFile>
-#include <QTextCodec>
+#include <QFileInfo>
+#include <QThreadStorage>
+#include <QHash>
+#include <QVarLengthArray>
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
 #include <QDebug>
 
 
@@ -42,10 +51,9 @@ struct ReaderData
 {
 public:
 
-    ReaderData(const char *buf, const quint64 size, QTextCodec *textCodec):
+    ReaderData(const char *buf, const quint64 size):
         mData(buf),
-        mSize(size),
-        mTextCodec(textCodec)
+        mSize(size)
     {
 
     }
@@ -54,7 +62,6 @@ public:
 
     const char   *mData;
     const quint64 mSize;
-    QTextCodec  *mTextCodec;
 
     bool compareStr(quint64 pos, const char *str) const;
     bool compareWord(quint64 pos, const char *str) const;
@@ -106,18 +113,101 @@ private:
     QVector<Section> mSections;
 };
 
+/************************************************
+ * PDF documents use a small set of names again and again
+ * (Type, Length, MediaBox, ...), so the names are interned,
+ * and the QString for the known name is shared, not allocated.
+ * The table has a fixed size and never grows, if the probe
+ * sequence is full the name is not interned.
+ * Every thread has its own table.
+ ************************************************/
+class NameTable
+{
+public:
+    static NameTable *instance();
+    QString name(const char *data, int len);
+
+private:
+    enum {
+        TableSize = 4096,
+        MaxProbes = 8,
+        MaxLength = 32
+    };
+
+    struct Entry
+    {
+        QByteArray raw;
+        QString name;
+    };
+
+    Entry mEntries[TableSize];
+};
+
+/************************************************
+ * The cache is shared by the prefetch threads,
+ * so all methods are guarded by the mutex.
+ ************************************************/
 class Reader::Cache{
 public:
+    struct ObjectStream
+    {
+        ObjectStream():
+            first(0),
+            extendsObjNum(0),
+            extendsGenNum(0)
+        {
+        }
+
+        QByteArray  data;
+        quint32     first;
+        QHash<PDF::ObjNum, quint32> offsets;
+        PDF::ObjNum extendsObjNum;
+        PDF::GenNum extendsGenNum;
+    };
+
     Cache();
     ~Cache();
 
-    const QByteArray getStream(PDF::ObjNum objNum, PDF::GenNum genNum) const;
-    void  setStream(PDF::ObjNum objNum, PDF::GenNum genNum, QByteArray stream);
+    bool contains(PDF::ObjNum objNum, PDF::GenNum genNum) const;
+    ObjectStream objectStream(PDF::ObjNum objNum, PDF::GenNum genNum, bool *found) const;
+    void setObjectStream(PDF::ObjNum objNum, PDF::GenNum genNum, const ObjectStream &stream);
 
     void clear();
 
 private:
-    QHash<quint64, QByteArray> mStreams;
+    mutable QMutex mMutex;
+    QHash<quint64, ObjectStream> mObjectStreams;
+};
+
+
+/************************************************
+ *
+ ************************************************/
+class ObjectStreamLoader: public QRunnable
+{
+public:
+    ObjectStreamLoader(const Reader *reader, ObjNum objNum):
+        mReader(reader),
+        mObjNum(objNum)
+    {
+    }
+
+    void run() override
+    {
+        try
+        {
+            mReader->loadObjectStream(mObjNum, 0);
+        }
+        catch (...)
+        {
+            // The prefetch is only an optimization, the error will
+            // be reported when the object is actually read.
+        }
+    }
+
+private:
+    const Reader *mReader;
+    ObjNum mObjNum;
 };
 
 
@@ -125,6 +215,46 @@ private:
 using namespace PDF;
 
 
+/************************************************
+ *
+ ************************************************/
+NameTable *NameTable::instance()
+{
+    static QThreadStorage<NameTable*> tables;
+    if (!tables.hasLocalData())
+        tables.setLocalData(new NameTable());
+
+    return tables.localData();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QString NameTable::name(const char *data, int len)
+{
+    if (len > MaxLength)
+        return QString::fromLatin1(data, len);
+
+    const uint hash = qHashBits(data, len);
+    for (int i=0; i<MaxProbes; ++i)
+    {
+        Entry &entry = mEntries[(hash + i) & (TableSize - 1)];
+        if (entry.raw.isNull())
+        {
+            entry.raw  = QByteArray(data, len);
+            entry.name = QString::fromLatin1(data, len);
+            return entry.name;
+        }
+
+        if (entry.raw.size() == len && memcmp(entry.raw.constData(), data, len) == 0)
+            return entry.name;
+    }
+
+    return QString::fromLatin1(data, len);
+}
+
+
 /************************************************
  *
  ************************************************/
@@ -144,18 +274,32 @@ Reader::Cache::~Cache()
 /************************************************
  *
  ************************************************/
-const QByteArray Reader::Cache::getStream(PDF::ObjNum objNum, PDF::GenNum genNum) const
+bool Reader::Cache::contains(ObjNum objNum, GenNum genNum) const
 {
-    return mStreams.value((quint64(objNum) << 32) + genNum);
+    QMutexLocker locker(&mMutex);
+    return mObjectStreams.contains((quint64(objNum) << 32) + genNum);
 }
 
 
 /************************************************
  *
  ************************************************/
-void Reader::Cache::setStream(ObjNum objNum, GenNum genNum, QByteArray stream)
+Reader::Cache::ObjectStream Reader::Cache::objectStream(ObjNum objNum, GenNum genNum, bool *found) const
 {
-    mStreams.insert((quint64(objNum) << 32) + genNum, stream);
+    QMutexLocker locker(&mMutex);
+    auto it = mObjectStreams.constFind((quint64(objNum) << 32) + genNum);
+    *found = (it != mObjectStreams.constEnd());
+    return *found ? it.value() : ObjectStream();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void Reader::Cache::setObjectStream(ObjNum objNum, GenNum genNum, const ObjectStream &stream)
+{
+    QMutexLocker locker(&mMutex);
+    mObjectStreams.insert((quint64(objNum) << 32) + genNum, stream);
 }
 
 
@@ -164,7 +308,8 @@ void Reader::Cache::setStream(ObjNum objNum, GenNum genNum, QByteArray stream)
  ************************************************/
 void Reader::Cache::clear()
 {
-    mStreams.clear();
+    QMutexLocker locker(&mMutex);
+    mObjectStreams.clear();
 }
 
 
@@ -288,8 +433,7 @@ quint64 XRefStreamData::readField(qint64 pos, int len) const
  ************************************************/
 bool ReaderData::isDelim(quint64 pos) const
 {
-    return isspace(mData[pos]) ||
-            strchr("()<>[]{}/%", mData[pos]);
+    return Scan::isDelim(mData[pos]);
 }
 
 
@@ -322,10 +466,9 @@ quint64 ReaderData::skipSpace(quint64 pos) const
 {
     while (pos < mSize)
     {
-        while (pos < mSize && isspace(mData[pos]))
-            pos++;
+        pos = Scan::skipSpace(mData + pos, mData + mSize) - mData;
 
-        if (mData[pos] != '%')
+        if (pos >= mSize || mData[pos] != '%')
             return pos;
 
         pos = skipComment(pos);
@@ -340,10 +483,10 @@ quint64 ReaderData::skipSpace(quint64 pos) const
  ************************************************/
 quint64 ReaderData::skipComment(quint64 pos) const
 {
-    while (pos < mSize && mData[pos] != '\n' && mData[pos] != '\r')
-        ++pos;
+    if (pos >= mSize)
+        return pos;
 
-    return pos;
+    return Scan::findEol(mData + pos, mData + mSize) - mData;
 }
 
 
@@ -364,15 +507,11 @@ qint64 ReaderData::skipCRLF(quint64 pos) const
  ************************************************/
 qint64 ReaderData::indexOf(const char *str, quint64 from) const
 {
-    size_t len = strlen(str);
-
-    for (quint64 i = from; i<mSize-len; i++)
-    {
-        if (strncmp(mData + i, str, len) == 0)
-            return i;
-    }
+    if (from >= mSize)
+        return -1;
 
-    return -1;
+    const char *res = Scan::find(mData + from, mData + mSize, str, strlen(str));
+    return res ? res - mData : -1;
 }
 
 
@@ -382,15 +521,9 @@ qint64 ReaderData::indexOf(const char *str, quint64 from) const
  ************************************************/
 qint64 ReaderData::indexOfBack(const char *str, quint64 from) const
 {
-    size_t len = strlen(str);
-
-    for (quint64 i = from - len + 1 ; i>0; i--)
-    {
-        if (strncmp(mData + i, str, len) == 0)
-            return i;
-    }
-
-    return -1;
+    quint64 end = qMin(from + 1, mSize);
+    const char *res = Scan::findBack(mData, mData + end, str, strlen(str));
+    return res ? res - mData : -1;
 }
 
 
@@ -399,64 +532,136 @@ qint64 ReaderData::indexOfBack(const char *str, quint64 from) const
  ************************************************/
 quint32 ReaderData::readUInt(quint64 *pos, bool *ok) const
 {
-    char *end;
-    quint32 res = strtoul(mData + *pos, &end, 10);
-    *ok = end != mData + *pos;
-    *pos = end - mData;
+    // Like strtoul, skips leading white spaces.
+    quint64 p = *pos;
+    while (p < mSize && Scan::isSpace(mData[p]))
+        ++p;
+
+    if (p < mSize && mData[p] == '+')
+        ++p;
+
+    const quint64 start = p;
+    quint32 res = 0;
+    for (; p < mSize && Scan::isDigit(mData[p]); ++p)
+        res = res * 10 + (mData[p] - '0');
+
+    *ok = p != start;
+    if (*ok)
+        *pos = p;
+
     return res;
 }
 
 
 /************************************************
- *
+ * The numbers are parsed directly from the data, the digits
+ * after the 17th in the fractional part are ignored, they
+ * are beyond the double precision anyway.
  ************************************************/
 double ReaderData::readNum(quint64 *pos, bool *ok) const
 {
-    const char * str = mData + *pos;
-    int sign = 1;
-    if (str[0] == '-')
+    quint64 p = *pos;
+    bool negative = false;
+    if (p < mSize && (mData[p] == '-' || mData[p] == '+'))
     {
-        ++str;
-        sign = -1;
+        negative = (mData[p] == '-');
+        ++p;
     }
 
-    char *end;
-    double res = strtoll(str, &end, 10);
-    if (end[0] == '.')
+    quint64 digits = p;
+    double res = 0;
+    for (; p < mSize && Scan::isDigit(mData[p]); ++p)
+        res = res * 10 + (mData[p] - '0');
+
+    bool hasDigits = p != digits;
+
+    if (p < mSize && mData[p] == '.')
     {
-        ++end;
-        if (isdigit(end[0]))
+        ++p;
+        digits = p;
+        quint64 fract = 0;
+        quint64 scale = 1;
+        for (; p < mSize && Scan::isDigit(mData[p]); ++p)
         {
-            str = end;
-            long long fract = strtoll(str, &end, 10);
-            if (str < end)
-                res += fract / pow(10.0, end - str);
+            if (p - digits < 17)
+            {
+                fract = fract * 10 + (mData[p] - '0');
+                scale *= 10;
+            }
+        }
+
+        if (p != digits)
+        {
+            res += double(fract) / double(scale);
+            hasDigits = true;
         }
     }
-    *ok = end != mData + *pos;
-    *pos = end - mData;
-    return res * sign;
+
+    *ok = hasDigits;
+    if (*ok)
+        *pos = p;
+
+    return negative ? -res : res;
 }
 
 
 /************************************************
  *
  ************************************************/
+static inline int hexDigit(char c)
+{
+    if (c <= '9') return c - '0';
+    if (c <= 'F') return c - 'A' + 10;
+    return c - 'a' + 10;
+}
+
+
+/************************************************
+ * Beginning with PDF 1.2, any character except null may
+ * be included in a name by writing it as #xx. The name is
+ * decoded into the stack buffer, the heap is only used for
+ * the names longer than 127 bytes.
+ ************************************************/
 QString ReaderData::readNameString(quint64 *pos) const
 {
     if (mData[*pos] != '/')
         throw ReaderError("Invalid PDF name, starting marker '/' was not found", *pos);
 
     quint64 start = *pos;
-    for (++(*pos); *pos < mSize; ++(*pos))
+    const char *begin = mData + start + 1;
+    const char *end   = Scan::findDelim(begin, mData + mSize);
+    if (end == mData + mSize)
+        throw ReaderError("Invalid PDF name on pos", start);
+
+    *pos = end - mData;
+    const int len = end - begin;
+
+    if (!memchr(begin, '#', len))
+        return NameTable::instance()->name(begin, len);
+
+    char buf[128];
+    QByteArray heap;
+    char *out = buf;
+    if (len > int(sizeof(buf)))
+    {
+        heap.resize(len);
+        out = heap.data();
+    }
+
+    int n = 0;
+    for (const char *c = begin; c < end; ++c)
     {
-        if (isDelim(*pos))
+        if (*c == '#' && end - c > 2 && Scan::isHex(c[1]) && Scan::isHex(c[2]))
         {
-            return QString::fromLocal8Bit(mData + start + 1, *pos - start - 1);
+            out[n++] = hexDigit(c[1]) * 16 + hexDigit(c[2]);
+            c += 2;
+            continue;
         }
+
+        out[n++] = *c;
     }
 
-    throw ReaderError("Invalid PDF name on pos", start);
+    return NameTable::instance()->name(out, n);
 }
 
 
@@ -538,7 +743,7 @@ qint64 ReaderData::readHexString(quint64 start, String *res) const
             if (!first)
                 string.append(r * 16);
 
-            res->setValue(QTextCodec::codecForUtfText(string, mTextCodec)->toUnicode(string));
+            res->setData(string);
             res->setEncodingType(String::HexEncoded);
             return pos + 1;
         }
@@ -738,7 +943,7 @@ qint64 ReaderData::readLiteralString(qint64 start, String *res) const
 
                 if (level == 0)
                 {
-                    res->setValue(QTextCodec::codecForUtfText(data, mTextCodec)->toUnicode(data));
+                    res->setData(data);
                     res->setEncodingType(String::LiteralEncoded);
                     return i + 1;
                 }
@@ -765,15 +970,24 @@ qint64 ReaderData::readArray(quint64 start, Array *res) const
 {
     quint64 pos = skipSpace(start + 1);
 
+    // The most of arrays (MediaBox, Kids, Widths of the small fonts) are
+    // short. They are collected on the stack, so the vector is allocated
+    // once with the exact size instead of growing value by value.
+    QVarLengthArray<Value, 16> values;
     while (pos < mSize)
     {
         if (mData[pos] == ']')
         {
+            QVector<Value> &vector = res->values();
+            vector.reserve(values.count());
+            for (int i=0; i<values.count(); ++i)
+                vector.append(values.at(i));
+
             res->setValid(true);
             return pos + 1;
         }
 
-        res->append(readValue(&pos));
+        values.append(readValue(&pos));
         pos = skipSpace(pos);
     }
 
@@ -955,11 +1169,9 @@ Value ReaderData::readValue(quint64 *pos) const
  *
  ************************************************/
 Reader::Reader():
-    mFile(nullptr),
     mData(nullptr),
     mSize(0),
     mPagesCount(-1),
-    mTextCodec(QTextCodec::codecForName("UTF-8")),
     mCache(new Cache())
 {
 
@@ -972,8 +1184,6 @@ Reader::Reader():
 Reader::~Reader()
 {
     close();
-
-    delete mFile;
     delete mCache;
 }
 
@@ -983,7 +1193,7 @@ Reader::~Reader()
  ************************************************/
 Value Reader::readValue(quint64 *pos) const
 {
-    return ReaderData(mData, mSize, mTextCodec).readValue(pos);
+    return ReaderData(mData, mSize).readValue(pos);
 }
 
 
@@ -992,7 +1202,7 @@ Value Reader::readValue(quint64 *pos) const
  ************************************************/
 qint64 Reader::readObject(quint64 start, Object *res) const
 {
-    ReaderData data(mData, mSize, mTextCodec);
+    ReaderData data(mData, mSize);
     quint64 pos = start;
 
     bool ok;
@@ -1018,7 +1228,7 @@ qint64 Reader::readObject(quint64 start, Object *res) const
     {
         pos = data.skipCRLF(pos + strlen("stream"));
 
-        qint64 len = 0;
+        qint64 len = -1;
         Value v = res->dict().value("Length");
         switch (v.type()) {
         case Value::Type::Number:
@@ -1026,17 +1236,44 @@ qint64 Reader::readObject(quint64 start, Object *res) const
             break;
 
         case Value::Type::Link:
-            len = getObject(v.asLink().objNum(), v.asLink().genNum()).value().asNumber().value();
+            try
+            {
+                len = getObject(v.asLink().objNum(), v.asLink().genNum()).value().asNumber().value();
+            }
+            catch (const Error &)
+            {
+                len = -1;
+            }
             break;
 
         default:
-            throw ReaderError(QString("Incorrect stream length in object at %1.").arg(data.mData[start]), pos);
+            break;
+        }
+
+        // Fast path: the Length is trusted if the "endstream" is exactly
+        // where it points, so even multi-megabyte images are not scanned.
+        quint64 end = pos + len;
+        if (len < 0 || end > mSize || !data.compareWord(data.skipSpace(end), "endstream"))
+        {
+            qint64 endStream = data.indexOf("endstream", pos);
+            if (endStream < 0)
+                throw ReaderError(QString("The \"endstream\" marker was not found in object %1 %2.")
+                                  .arg(res->objNum()).arg(res->genNum()), pos);
+
+            // There should be an end-of-line marker after the data
+            // and before endstream; this marker is not included in the stream length.
+            end = endStream;
+            if (end > pos && data[end - 1] == '\n')
+                --end;
+
+            if (end > pos && data[end - 1] == '\r')
+                --end;
+
+            len = end - pos;
         }
 
         res->setStream(QByteArray::fromRawData(data.mData + pos, len));
-        pos = data.skipSpace(pos + len);
-        if (data.compareWord(pos, "endstream"))
-            pos += strlen("endstream");
+        pos = data.skipSpace(end) + strlen("endstream");
     }
 
     pos = data.skipSpace(pos);
@@ -1070,57 +1307,101 @@ void Reader::readObjectFromStream(ObjNum objNum, Object *res, ObjNum streamObjNu
 {
     Q_UNUSED(stremIndex)
 
-    const Object &streamObj = getObject(streamObjNum, streamGenNum);
+    bool cached;
+    Cache::ObjectStream stream = mCache->objectStream(streamObjNum, streamGenNum, &cached);
+    if (!cached)
+    {
+        loadObjectStream(streamObjNum, streamGenNum);
+        stream = mCache->objectStream(streamObjNum, streamGenNum, &cached);
+    }
+
+    auto it = stream.offsets.constFind(objNum);
+    if (it != stream.offsets.constEnd())
+    {
+        ReaderData data(stream.data.constData(), stream.data.size());
 
-    QByteArray stream = mCache->getStream(streamObjNum, streamGenNum);
-    if (stream.isEmpty())
+        res->setObjNum(objNum);
+        res->setGenNum(0);
+        quint64 pos = data.skipSpace(stream.first + it.value());
+        res->setValue(data.readValue(&pos));
+    }
+    else if (stream.extendsObjNum)
     {
-        stream = streamObj.decodedStream();
-        mCache->setStream(streamObjNum, streamGenNum, stream);
+        readObjectFromStream(objNum, res, stream.extendsObjNum, stream.extendsGenNum, 0);
     }
+}
+
 
-    ReaderData data(stream.data(), stream.size(), mTextCodec);
+/************************************************
+ * Decodes the object stream and builds the index of
+ * the object offsets, the result is stored in the cache.
+ ************************************************/
+void Reader::loadObjectStream(ObjNum objNum, GenNum genNum) const
+{
+    const Object streamObj = getObject(objNum, genNum);
+
+    Cache::ObjectStream res;
+    res.data  = streamObj.decodedStream();
+    // The byte offset (in the decoded stream) of the first compressed object.
+    res.first = streamObj.dict().value("First").asNumber().value();
+
+    const Link &extends = streamObj.dict().value("Extends").asLink();
+    if (extends.isValid())
+    {
+        res.extendsObjNum = extends.objNum();
+        res.extendsGenNum = extends.genNum();
+    }
 
     // The number of compressed objects in the stream.
     uint cnt = streamObj.dict().value("N").asNumber().value();
+    res.offsets.reserve(cnt);
 
-    quint32 offset = 0;
-    bool found = false;
-
+    ReaderData data(res.data.constData(), res.data.size());
     quint64 pos = 0;
     for (uint i=0; i<cnt; ++i)
     {
         bool ok;
         ObjNum num = data.readUInt(&pos, &ok);
-        pos = data.skipSpace(pos);
-        offset = data.readUInt(&pos, &ok);
+        if (!ok)
+            break;
 
-        if (num == objNum)
-        {
-            found = true;
+        pos = data.skipSpace(pos);
+        quint32 offset = data.readUInt(&pos, &ok);
+        if (!ok)
             break;
-        }
+
+        if (!res.offsets.contains(num))
+            res.offsets.insert(num, offset);
     }
 
-    if (found)
-    {
-        res->setObjNum(objNum);
-        res->setGenNum(0);
-        // The byte offset (in the decoded stream) of the first compressed object.
-        uint firstOffset = streamObj.dict().value("First").asNumber();
-        pos = offset + firstOffset;
+    mCache->setObjectStream(objNum, genNum, res);
+}
 
-        pos = data.skipSpace(pos);
-        res->setValue(data.readValue(&pos));
+
+/************************************************
+ *
+ ************************************************/
+void Reader::prefetchObjectStreams() const
+{
+    QSet<ObjNum> streams;
+    for (auto it = mXRefTable.constBegin(); it != mXRefTable.constEnd(); ++it)
+    {
+        if (it.value().type() == XRefEntry::Compressed)
+            streams << it.value().streamObjNum();
     }
-    else
+
+    if (streams.count() < 2)
+        return;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+    foreach (ObjNum num, streams)
     {
-        const Link &extends = streamObj.dict().value("Extends").asLink();
-        if (extends.isValid())
-        {
-            readObjectFromStream(objNum, res, extends.objNum(), extends.genNum(), 0);
-        }
+        if (!mCache->contains(num, 0))
+            pool.start(new ObjectStreamLoader(this, num));
     }
+
+    pool.waitForDone();
 }
 
 
@@ -1129,7 +1410,7 @@ void Reader::readObjectFromStream(ObjNum objNum, Object *res, ObjNum streamObjNu
  ************************************************/
 qint64 Reader::readXRefTable(quint64 pos, XRefTable *res, Dict *trailerDict) const
 {
-    ReaderData data(mData, mSize, mTextCodec);
+    ReaderData data(mData, mSize);
     pos = data.skipSpace(pos);
 
     if (!data.compareWord(pos, "xref"))
@@ -1304,13 +1585,9 @@ QByteArray Reader::rawData(quint64 pos, quint64 len) const
  ************************************************/
 void Reader::open(const QString &fileName, quint64 startPos, quint64 endPos)
 {
-    mFile = new QFile(fileName);
-
-    if(!mFile->open(QFile::ReadOnly))
-        throw Error(QString("I can't open file \"%1\":%2").arg(fileName).arg(mFile->errorString()));
-
-    int start = startPos;
-    int end   = endPos ? endPos : mFile->size();
+    quint64 fileSize = QFileInfo(fileName).size();
+    quint64 start = startPos;
+    quint64 end   = endPos ? endPos : fileSize;
 
     if (end < start)
         throw Error(QString("Invalid request for %1, the start position (%2) is greater than the end (%3) one.")
@@ -1318,9 +1595,19 @@ void Reader::open(const QString &fileName, quint64 startPos, quint64 endPos)
             .arg(startPos)
             .arg(endPos));
 
-    mFile->seek(start);
-    mSize  =  end - start;
-    mData  = reinterpret_cast<const char*>(mFile->map(start, mSize));
+    if (end > fileSize)
+        throw Error(QString("Invalid request for %1, the end position (%2) is beyond the end of the file.")
+            .arg(fileName)
+            .arg(endPos));
+
+    // Only the document bytes are mapped, so the job in the middle
+    // of the large file doesn't take the address space of the whole file.
+    mFile  = MappedFile(fileName, start, end - start);
+    mSize  = end - start;
+    mData  = mFile.data();
+
+    // The xref table is at the end, and the objects are read in random order.
+    advise(MappedFile::RandomAccess);
     load();
 }
 
@@ -1330,6 +1617,7 @@ void Reader::open(const QString &fileName, quint64 startPos, quint64 endPos)
  ************************************************/
 void Reader::open(const char * const data, quint64 size)
 {
+    mFile = MappedFile();
     mData = data;
     mSize = size;
     load();
@@ -1343,13 +1631,22 @@ void Reader::close()
 {
     mCache->clear();
 
-    if (mFile && mData)
-        mFile->unmap(const_cast<uchar*>(reinterpret_cast<const uchar*>(mData)));
+    mFile = MappedFile();
     mData = nullptr;
     mSize = 0;
 }
 
 
+/************************************************
+ *
+ ************************************************/
+void Reader::advise(MappedFile::Advice advice) const
+{
+    if (!mFile.isNull() && mData)
+        mFile.advise(advice, 0, mSize);
+}
+
+
 /************************************************
  *
  ************************************************/
@@ -1357,7 +1654,7 @@ void Reader::load()
 {
     mXRefTable.clear();
     mTrailerDict.clear();
-    ReaderData data(mData, mSize, mTextCodec);
+    ReaderData data(mData, mSize);
 
     // Check header ...................................
     if (!data.compareStr(0, "%PDF-"))
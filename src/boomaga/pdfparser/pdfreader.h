@@ -31,8 +31,7 @@
 #include <exception>
 #include "pdfvalue.h"
 #include "pdfxref.h"
-
-class QFile;
+#include "pdfmappedfile.h"
 
 namespace PDF {
 
@@ -68,6 +67,7 @@ class Data;
 /// The PDF::REader class provides a way to read PDF documents.
 class Reader
 {
+    friend class ObjectStreamLoader;
 public:
     /// Constructs a Reader object.
     Reader();
@@ -89,6 +89,10 @@ public:
     /// Closes this reader for reading.
     void close();
 
+    /// Gives the kernel a hint about how the document data will be used.
+    /// Does nothing if the reader was opened from the memory buffer.
+    void advise(MappedFile::Advice advice) const;
+
     const XRefTable &xRefTable() const { return mXRefTable; }
     const Dict &trailerDict() const { return mTrailerDict; }
     Dict trailerDict() { return mTrailerDict; }
@@ -101,6 +105,10 @@ public:
 
     quint32 pageCount();
 
+    /// Decodes all object streams in parallel and stores them in the cache,
+    /// so later reads of the compressed objects don't inflate them one by one.
+    void prefetchObjectStreams() const;
+
     /// Constructs a QByteArray that uses len bytes from the data,
     /// starting at position pos. The bytes are not copied.
     /// The caller guarantees that reader will not be closed as long
@@ -115,14 +123,14 @@ protected:
     void readObjectFromStream(PDF::ObjNum objNum, Object *res, PDF::ObjNum streamObjNum, GenNum streamGenNum, quint32 stremIndex) const;
     qint64 readXRefTable(quint64 start, XRefTable *res, Dict *trailerDict) const;
     qint64 readXRefStream(qint64 start, XRefTable *xref, Dict *trailerDict) const;
+    void loadObjectStream(PDF::ObjNum objNum, GenNum genNum) const;
 private:
-    QFile      *mFile;
+    MappedFile  mFile;
     const char *mData;
     quint64     mSize;
     XRefTable   mXRefTable;
     Dict        mTrailerDict;
     int         mPagesCount;
-    QTextCodec  *mTextCodec;
 
     class Cache;
     Cache       *mCache;
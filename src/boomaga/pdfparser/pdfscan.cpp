@@ -0,0 +1,378 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2012-2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#include "pdfscan.h"
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define PDF_SCAN_X86
+#include <immintrin.h>
+#endif
+
+using namespace PDF;
+
+
+const quint8 Scan::charClass[256] = {
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00,  // 00
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // 10
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,  // 20
+    0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x00, 0x00, 0x02, 0x00, 0x02, 0x00,  // 30
+    0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // 40
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x02, 0x00, 0x00,  // 50
+    0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // 60
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x02, 0x00, 0x00,  // 70
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // 80
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // 90
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // A0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // B0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // C0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // D0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // E0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00  // F0
+};
+
+
+#ifdef PDF_SCAN_X86
+
+/************************************************
+ * __builtin_cpu_supports is cheap, but the result
+ * never changes, so it is calculated only once.
+ ************************************************/
+static bool hasAvx2()
+{
+    static const bool res = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    return res;
+}
+
+
+/************************************************
+ * \t \n \v \f \r are 9..13, so they are checked
+ * with one unsigned comparison.
+ ************************************************/
+static inline __m128i spaceMask(__m128i v)
+{
+    const __m128i t   = _mm_sub_epi8(v, _mm_set1_epi8(9));
+    const __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(4)), t);
+    return _mm_or_si128(ctl, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+}
+
+
+/************************************************
+ *
+ ************************************************/
+static inline __m128i delimMask(__m128i v)
+{
+    __m128i res = spaceMask(v);
+    static const char delims[] = "()<>[]{}/%";
+    for (const char *d = delims; *d; ++d)
+        res = _mm_or_si128(res, _mm_cmpeq_epi8(v, _mm_set1_epi8(*d)));
+
+    return _mm_or_si128(res, _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+}
+
+
+/************************************************
+ *
+ ************************************************/
+static inline __m128i eolMask(__m128i v)
+{
+    return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                        _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+}
+
+
+/************************************************
+ * Searches for the candidates where both the first and the last
+ * characters of the string match, only they are compared by memcmp.
+ * The pos is updated to the first position which is not checked yet.
+ ************************************************/
+static const char *findSse2(const char *data, qint64 size, qint64 *pos, const char *str, size_t len)
+{
+    const __m128i first = _mm_set1_epi8(str[0]);
+    const __m128i last  = _mm_set1_epi8(str[len - 1]);
+
+    qint64 i = *pos;
+    for (; i + qint64(len) - 1 + 16 <= size; i += 16)
+    {
+        const __m128i bf = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i bl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + len - 1));
+        uint mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, bf), _mm_cmpeq_epi8(last, bl)));
+
+        while (mask)
+        {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(data + i + bit + 1, str + 1, len - 2) == 0)
+            {
+                *pos = i + bit;
+                return data + i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    *pos = i;
+    return nullptr;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+__attribute__((target("avx2")))
+static const char *findAvx2(const char *data, qint64 size, qint64 *pos, const char *str, size_t len)
+{
+    const __m256i first = _mm256_set1_epi8(str[0]);
+    const __m256i last  = _mm256_set1_epi8(str[len - 1]);
+
+    qint64 i = *pos;
+    for (; i + qint64(len) - 1 + 32 <= size; i += 32)
+    {
+        const __m256i bf = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i bl = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + len - 1));
+        uint mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, bf), _mm256_cmpeq_epi8(last, bl)));
+
+        while (mask)
+        {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(data + i + bit + 1, str + 1, len - 2) == 0)
+            {
+                *pos = i + bit;
+                return data + i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    *pos = i;
+    return nullptr;
+}
+
+
+/************************************************
+ * The same as findSse2, but goes from the end. The last is
+ * the greatest candidate position which is not checked yet.
+ ************************************************/
+static const char *findBackSse2(const char *data, qint64 *last, const char *str, size_t len)
+{
+    const __m128i first = _mm_set1_epi8(str[0]);
+    const __m128i lastCh = _mm_set1_epi8(str[len - 1]);
+
+    qint64 i = *last - 15;
+    for (; i >= 0; i -= 16)
+    {
+        const __m128i bf = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i bl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + len - 1));
+        uint mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, bf), _mm_cmpeq_epi8(lastCh, bl)));
+
+        while (mask)
+        {
+            int bit = 31 - __builtin_clz(mask);
+            if (memcmp(data + i + bit + 1, str + 1, len - 2) == 0)
+                return data + i + bit;
+
+            mask &= ~(1u << bit);
+        }
+    }
+
+    *last = i + 15;
+    return nullptr;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+__attribute__((target("avx2")))
+static const char *findBackAvx2(const char *data, qint64 *last, const char *str, size_t len)
+{
+    const __m256i first = _mm256_set1_epi8(str[0]);
+    const __m256i lastCh = _mm256_set1_epi8(str[len - 1]);
+
+    qint64 i = *last - 31;
+    for (; i >= 0; i -= 32)
+    {
+        const __m256i bf = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i bl = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + len - 1));
+        uint mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, bf), _mm256_cmpeq_epi8(lastCh, bl)));
+
+        while (mask)
+        {
+            int bit = 31 - __builtin_clz(mask);
+            if (memcmp(data + i + bit + 1, str + 1, len - 2) == 0)
+                return data + i + bit;
+
+            mask &= ~(1u << bit);
+        }
+    }
+
+    *last = i + 31;
+    return nullptr;
+}
+
+#endif // PDF_SCAN_X86
+
+
+/************************************************
+ * The most of white space runs are one or two characters
+ * long, so the first character is checked without SIMD.
+ ************************************************/
+const char *Scan::skipSpace(const char *begin, const char *end)
+{
+    const char *p = begin;
+    if (p < end && !isSpace(*p))
+        return p;
+
+#ifdef PDF_SCAN_X86
+    for (; end - p >= 16; p += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        uint mask = ~uint(_mm_movemask_epi8(spaceMask(v))) & 0xFFFF;
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+#endif
+
+    while (p < end && isSpace(*p))
+        ++p;
+
+    return p;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+const char *Scan::findDelim(const char *begin, const char *end)
+{
+    const char *p = begin;
+
+#ifdef PDF_SCAN_X86
+    for (; end - p >= 16; p += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        uint mask = _mm_movemask_epi8(delimMask(v));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+#endif
+
+    while (p < end && !isDelim(*p))
+        ++p;
+
+    return p;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+const char *Scan::findEol(const char *begin, const char *end)
+{
+    const char *p = begin;
+
+#ifdef PDF_SCAN_X86
+    for (; end - p >= 16; p += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        uint mask = _mm_movemask_epi8(eolMask(v));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+#endif
+
+    while (p < end && *p != '\n' && *p != '\r')
+        ++p;
+
+    return p;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+const char *Scan::find(const char *begin, const char *end, const char *str, size_t len)
+{
+    const qint64 size = end - begin;
+    if (len == 0 || size < qint64(len))
+        return nullptr;
+
+    if (len == 1)
+        return static_cast<const char*>(memchr(begin, str[0], size));
+
+    qint64 pos = 0;
+#ifdef PDF_SCAN_X86
+    const char *res = hasAvx2() ?
+                findAvx2(begin, size, &pos, str, len) :
+                findSse2(begin, size, &pos, str, len);
+    if (res)
+        return res;
+#endif
+
+    while (size - pos >= qint64(len))
+    {
+        const char *p = static_cast<const char*>(memchr(begin + pos, str[0], size - pos - len + 1));
+        if (!p)
+            return nullptr;
+
+        if (memcmp(p, str, len) == 0)
+            return p;
+
+        pos = p - begin + 1;
+    }
+
+    return nullptr;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+const char *Scan::findBack(const char *begin, const char *end, const char *str, size_t len)
+{
+    const qint64 size = end - begin;
+    if (len == 0 || size < qint64(len))
+        return nullptr;
+
+    qint64 last = size - len;
+#ifdef PDF_SCAN_X86
+    if (len > 1)
+    {
+        const char *res = hasAvx2() ?
+                    findBackAvx2(begin, &last, str, len) :
+                    findBackSse2(begin, &last, str, len);
+        if (res)
+            return res;
+    }
+#endif
+
+    for (; last >= 0; --last)
+    {
+        if (begin[last] == str[0] && memcmp(begin + last, str, len) == 0)
+            return begin + last;
+    }
+
+    return nullptr;
+}
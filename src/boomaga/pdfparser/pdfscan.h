@@ -0,0 +1,77 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2012-2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#ifndef PDFSCAN_H
+#define PDFSCAN_H
+
+#include <QtGlobal>
+#include <stddef.h>
+
+namespace PDF {
+
+/// Low level scanning functions used by the PDF::Reader tokenizer.
+///
+/// The character classes are taken from the lookup table, the long runs
+/// are processed by SSE2 or AVX2 code when the CPU supports it. All
+/// functions work on the half-open range [begin, end) and never read
+/// outside of it.
+namespace Scan {
+
+enum CharClass
+{
+    SpaceChar   = 0x01, ///< Space, \t, \n, \v, \f, \r
+    DelimChar   = 0x02, ///< ( ) < > [ ] { } / % and NUL
+    DigitChar   = 0x04, ///< 0-9
+    HexChar     = 0x08  ///< 0-9, A-F, a-f
+};
+
+extern const quint8 charClass[256];
+
+inline bool isSpace(char c) { return charClass[uchar(c)] & SpaceChar; }
+inline bool isDelim(char c) { return charClass[uchar(c)] & (SpaceChar | DelimChar); }
+inline bool isDigit(char c) { return charClass[uchar(c)] & DigitChar; }
+inline bool isHex(char c)   { return charClass[uchar(c)] & HexChar; }
+
+/// Returns a pointer to the first non-white-space character, or end.
+const char *skipSpace(const char *begin, const char *end);
+
+/// Returns a pointer to the first delimiter or white-space character, or end.
+const char *findDelim(const char *begin, const char *end);
+
+/// Returns a pointer to the first \r or \n character, or end.
+const char *findEol(const char *begin, const char *end);
+
+/// Returns a pointer to the first occurrence of the str, or nullptr.
+const char *find(const char *begin, const char *end, const char *str, size_t len);
+
+/// Returns a pointer to the last occurrence of the str which entirely lies
+/// in the range, or nullptr.
+const char *findBack(const char *begin, const char *end, const char *str, size_t len);
+
+} // namespace Scan
+} // namespace PDF
+
+#endif // PDFSCAN_H
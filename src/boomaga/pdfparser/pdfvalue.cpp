@@ -73,6 +73,7 @@ Value::Value(const Value &other):
     mArrayValues( other.mArrayValues),
     mDictValues ( other.mDictValues),
     mStringValue( other.mStringValue),
+    mStringData(  other.mStringData),
     mNumberValue( other.mNumberValue),
     mLinkObjNum(  other.mLinkObjNum),
     mLinkGenNum(  other.mLinkGenNum),
@@ -113,6 +114,7 @@ Value &Value::operator =(const Value &other)
     mBoolValue      = other.mBoolValue;
     mDictValues     = other.mDictValues;
     mStringValue    = other.mStringValue;
+    mStringData     = other.mStringData;
     mLinkObjNum     = other.mLinkObjNum;
     mLinkGenNum     = other.mLinkGenNum;
     mNumberValue    = other.mNumberValue;
@@ -284,7 +286,7 @@ bool Value::operator==(const Value &other) const
     case Type::Name:            return mStringValue == other.mStringValue;
     case Type::Null:            return true;
     case Type::Number:          return mNumberValue == other.mNumberValue;
-    case Type::String:          return mStringValue == other.mStringValue;
+    case Type::String:          return mStringData  == other.mStringData;
     }
     return false;
 }
@@ -486,7 +488,7 @@ void PDF::Dict::clear()
 /************************************************
  *
  ************************************************/
-QMap<QString, Value> Dict::values()
+QMap<QString, Value> &Dict::values()
 {
     assert(mType == Type::Dict);
     return mDictValues;
@@ -605,9 +607,8 @@ int Dict::remove(const QString &key)
 QStringList Dict::keys() const
 {
     assert(mType == Type::Dict);
-    QStringList res = mDictValues.keys();
-    res.sort();
-    return res;
+    // QMap keeps the keys sorted.
+    return mDictValues.keys();
 }
 
 
@@ -618,7 +619,7 @@ String::String(const QString &value):
     Value(Type::String)
 {
     mValid = true;
-    mStringValue = value;
+    mStringData = value.toUtf8();
 }
 
 
@@ -649,7 +650,8 @@ String &String::operator =(const String &other)
 QString String::value() const
 {
     assert(mType == Type::String);
-    return mStringValue;
+    static QTextCodec *defaultCodec = QTextCodec::codecForName("UTF-8");
+    return QTextCodec::codecForUtfText(mStringData, defaultCodec)->toUnicode(mStringData);
 }
 
 
@@ -660,7 +662,28 @@ void String::setValue(const QString &value)
 {
     assert(mType == Type::String);
     if (mValid)
-        mStringValue = value.toLocal8Bit();
+        mStringData = value.toUtf8();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QByteArray String::data() const
+{
+    assert(mType == Type::String);
+    return mStringData;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void String::setData(const QByteArray &data)
+{
+    assert(mType == Type::String);
+    if (mValid)
+        mStringData = data;
 }
 
 
@@ -170,6 +170,7 @@ protected:
     QVector<Value> mArrayValues;
     QMap<QString, Value> mDictValues;
     QString mStringValue;
+    QByteArray mStringData;
     double  mNumberValue;
     quint32 mLinkObjNum;
     quint16 mLinkGenNum;
@@ -186,6 +187,14 @@ private:
 
 };
 
+} // namespace PDF
+
+// All members of the Value are implicitly shared Qt containers and PODs,
+// so QVector<Value> can move the values with memmove when it grows.
+Q_DECLARE_TYPEINFO(PDF::Value, Q_MOVABLE_TYPE);
+
+namespace PDF {
+
 #define HIDE_VALUE_METHODS \
 using Value::isArray;   \
 using Value::isBool;    \
@@ -324,7 +333,7 @@ public:
     /// will be 0 if the key isn't in the map.
     int remove(const QString &key);
 
-    QMap<QString, Value> values();
+    QMap<QString, Value> &values();
     const QMap<QString, Value> &values() const;
 
     /// Same as size().
@@ -362,9 +371,17 @@ public:
     String(const String &other);
     String &operator =(const String &other);
 
+    /// Returns the string decoded to Unicode. Strings with the byte order
+    /// mark are decoded as UTF-16 (or UTF-8), others as UTF-8.
     QString value() const;
+
+    /// Sets the string as UTF-8 encoded bytes.
     void setValue(const QString &value);
 
+    /// Returns the bytes of the string exactly as they are stored in the PDF.
+    QByteArray data() const;
+    void setData(const QByteArray &data);
+
     EncodingType encodingType() const;
     void setEncodingType(EncodingType type);
 
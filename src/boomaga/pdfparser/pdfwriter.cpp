@@ -30,6 +30,7 @@
 #include "pdfxref.h"
 #include <climits>
 #include <cmath>
+#include <cstring>
 
 #include <QUuid>
 #include <QDebug>
@@ -151,9 +152,10 @@ void Writer::writeValue(const Value &value)
     case Value::Type::Array:
     {
         mDevice->write("[");
-        foreach (const Value v, value.asArray().values())
+        const Array &arr = value.asArray();
+        for (int i=0; i<arr.count(); ++i)
         {
-            writeValue(v);
+            writeValue(arr.at(i));
             mDevice->write(" ");
         }
         mDevice->write("]");
@@ -182,8 +184,7 @@ void Writer::writeValue(const Value &value)
         QMap<QString, Value>::const_iterator i;
         for (i = values.constBegin(); i != values.constEnd(); ++i)
         {
-            write('/');
-            write(i.key());
+            writeName(i.key());
             write(' ');
             writeValue(i.value());
             write('\n');
@@ -209,8 +210,7 @@ void Writer::writeValue(const Value &value)
 
     //.....................................................
     case Value::Type::Name:
-        mDevice->write("/");
-        mDevice->write(value.asName().value().toLatin1());
+        writeName(value.asName().value());
         break;
 
 
@@ -235,7 +235,7 @@ void Writer::writeValue(const Value &value)
         if (s.encodingType() == String::HexEncoded)
         {
             write('<');
-            mDevice->write(s.value().toUtf8().toHex());
+            mDevice->write(s.data().toHex());
             write('>');
         }
         else
@@ -453,7 +453,7 @@ void Writer::writeLiteralString(const PDF::String &value)
 {
     char oct[5] = "\\000";
 
-    foreach (const char c, value.value().toUtf8())
+    foreach (const char c, value.data())
     {
         switch (c)
         {
@@ -514,6 +514,37 @@ void Writer::writeLiteralString(const PDF::String &value)
 }
 
 
+/************************************************
+ * The delimiters, white spaces, the number sign and
+ * non-ASCII characters are written as #xx.
+ ************************************************/
+void Writer::writeName(const QString &name)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    const QByteArray data = name.toLatin1();
+    QByteArray res;
+    res.reserve(data.size() * 3 + 1);
+    res.append('/');
+
+    foreach (const char c, data)
+    {
+        if (uchar(c) > ' ' && uchar(c) <= '~' && !strchr("()<>[]{}/%#", c))
+        {
+            res.append(c);
+        }
+        else
+        {
+            res.append('#');
+            res.append(hex[uchar(c) >> 4]);
+            res.append(hex[uchar(c) & 0x0F]);
+        }
+    }
+
+    mDevice->write(res);
+}
+
+
 /************************************************
  *
  ************************************************/
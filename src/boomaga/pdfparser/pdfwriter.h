@@ -90,6 +90,7 @@ protected:
     void writeValue(const Value &value);
     void writeXrefSection(const XRefTable::const_iterator &start, quint32 count);
     void writeLiteralString(const String &value);
+    void writeName(const QString &name);
 
     void write(const char value);
     void write(const char* value);
@@ -0,0 +1,217 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#include "prefetchpolicy.h"
+#include <QtMath>
+
+#define DEFAULT_BUDGET      31
+#define MIN_BEHIND          2
+#define MIN_AHEAD           4
+#define LOOKAHEAD_TIME      3.0     // sec
+#define IDLE_TIME           1500    // msec
+#define JUMP_SIZE           10      // sheets
+#define MIN_VELOCITY        0.5     // sheets per second
+
+
+/************************************************
+ *
+ ************************************************/
+PrefetchPolicy::PrefetchPolicy():
+    mBudget(DEFAULT_BUDGET),
+    mWorkerCount(1),
+    mRenderTime(200),
+    mLastSheet(-1),
+    mLastTime(0),
+    mVelocity(0)
+{
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void PrefetchPolicy::setBudget(int value)
+{
+    mBudget = qMax(MIN_BEHIND + MIN_AHEAD + 1, value);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void PrefetchPolicy::setWorkerCount(int value)
+{
+    mWorkerCount = qMax(1, value);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void PrefetchPolicy::setRenderTime(int msec)
+{
+    mRenderTime = qMax(1, msec);
+}
+
+
+/************************************************
+ * The velocity is smoothed over the last steps,
+ * long pauses and jumps reset it.
+ ************************************************/
+void PrefetchPolicy::visit(int sheetNum, qint64 msec)
+{
+    if (mLastSheet > -1)
+    {
+        qint64 dt = msec - mLastTime;
+        int    ds = sheetNum - mLastSheet;
+
+        if (dt > IDLE_TIME || qAbs(ds) > JUMP_SIZE)
+        {
+            mVelocity = 0;
+        }
+        else if (ds != 0 && dt > 0)
+        {
+            double v = ds * 1000.0 / dt;
+            if (mVelocity == 0 || (v > 0) != (mVelocity > 0))
+                mVelocity = v;
+            else
+                mVelocity = 0.5 * mVelocity + 0.5 * v;
+        }
+    }
+
+    mLastSheet = sheetNum;
+    mLastTime  = msec;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+int PrefetchPolicy::direction() const
+{
+    if (qAbs(mVelocity) < MIN_VELOCITY)
+        return 0;
+
+    return mVelocity > 0 ? 1 : -1;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+int PrefetchPolicy::maxAhead() const
+{
+    return mBudget - 1 - MIN_BEHIND;
+}
+
+
+/************************************************
+ * If the user is faster than the render, the
+ * requests wait in the queue, so we look further.
+ ************************************************/
+int PrefetchPolicy::lead() const
+{
+    if (direction() == 0)
+        return 0;
+
+    double v = qAbs(mVelocity);
+    double throughput = mWorkerCount * 1000.0 / mRenderTime;
+    int res = qCeil(v * mRenderTime / 1000.0 * qMax(1.0, 2 * v / throughput));
+    return qBound(0, res, maxAhead() - 2 * mWorkerCount);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+PrefetchPolicy::Window PrefetchPolicy::window(int sheetNum, int sheetCount) const
+{
+    int base = (mBudget - 1) * 2 / 3;
+    int dir = direction();
+
+    int ahead = base;
+    if (dir != 0)
+    {
+        double want = qMax(qMax(MIN_AHEAD + qAbs(mVelocity) * LOOKAHEAD_TIME, double(base)),
+                           double(lead() + 2 * mWorkerCount));
+        ahead = int(qMin(want, double(maxAhead())));
+    }
+
+    int behind = mBudget - 1 - ahead;
+    if (dir < 0)
+        qSwap(ahead, behind);
+
+    Window res;
+    res.first = qMax(0, sheetNum - behind);
+    res.last  = qMin(sheetCount - 1, sheetNum + ahead);
+    return res;
+}
+
+
+/************************************************
+ * The current sheet always goes first, it's needed
+ * right now, even when the user stops after fast
+ * paging. Then two sheets ahead for every sheet
+ * behind. The sheets closer than lead() would not
+ * be ready in time, so they go to the end of the list.
+ ************************************************/
+QVector<int> PrefetchPolicy::plan(int sheetNum, int sheetCount) const
+{
+    QVector<int> res;
+    if (sheetNum < 0 || sheetNum >= sheetCount)
+        return res;
+
+    Window win = window(sheetNum, sheetCount);
+    int dir  = direction() < 0 ? -1 : 1;
+    int skip = qMax(0, lead() - 1);
+
+    QVector<int> forward;
+    QVector<int> backward;
+    for (int i = sheetNum + dir; win.contains(i); i += dir)
+        forward << i;
+
+    for (int i = sheetNum - dir; win.contains(i); i -= dir)
+        backward << i;
+
+    res.reserve(forward.count() + backward.count() + 1);
+    res << sheetNum;
+
+    int f = qMin(skip, forward.count());
+    int b = 0;
+    while (f < forward.count() || b < backward.count())
+    {
+        for (int n=0; n<2 && f < forward.count(); ++n)
+            res << forward.at(f++);
+
+        if (b < backward.count())
+            res << backward.at(b++);
+    }
+
+    for (int i=0; i < qMin(skip, forward.count()); ++i)
+        res << forward.at(i);
+
+    return res;
+}
@@ -0,0 +1,88 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#ifndef PREFETCHPOLICY_H
+#define PREFETCHPOLICY_H
+
+#include <QVector>
+
+/// Decides which sheets should be rendered in advance.
+///
+/// The policy tracks the direction and the speed of the navigation.
+/// When the user pages quickly, the window of cached sheets is shifted in
+/// the direction of travel. If the user is faster than the render, the
+/// sheets that will be passed before they are ready are skipped.
+class PrefetchPolicy
+{
+public:
+    struct Window
+    {
+        int first;
+        int last;
+        bool contains(int sheetNum) const { return sheetNum >= first && sheetNum <= last; }
+    };
+
+    PrefetchPolicy();
+
+    /// The maximum number of sheets kept in the cache, including the current one.
+    int budget() const { return mBudget; }
+    void setBudget(int value);
+
+    int workerCount() const { return mWorkerCount; }
+    void setWorkerCount(int value);
+
+    /// Average time in msec to render one sheet by one worker.
+    int renderTime() const { return mRenderTime; }
+    void setRenderTime(int msec);
+
+    /// Informs the policy that the user has moved to the sheetNum at time msec.
+    void visit(int sheetNum, qint64 msec);
+
+    /// Navigation speed in sheets per second, negative when moving back.
+    double velocity() const { return mVelocity; }
+    int direction() const;
+
+    /// The number of sheets the user will pass while one sheet is rendered.
+    int lead() const;
+
+    Window window(int sheetNum, int sheetCount) const;
+
+    /// Returns the sheets of the window, the most important first.
+    /// The first one is always sheetNum, it should be requested as urgent.
+    QVector<int> plan(int sheetNum, int sheetCount) const;
+
+private:
+    int mBudget;
+    int mWorkerCount;
+    int mRenderTime;
+    int mLastSheet;
+    qint64 mLastTime;
+    double mVelocity;
+
+    int maxAhead() const;
+};
+
+#endif // PREFETCHPOLICY_H
@@ -33,10 +33,53 @@
 
 #include "kernel/project.h"
 #include "kernel/layout.h"
+#include "kernel/sheet.h"
+#include "kernel/printer.h"
+#include "kernel/projectpage.h"
 
 
 /************************************************
+ The cleanup functions for the QImages which use
+ the memory of another image.
+ ************************************************/
+static void releasePopplerImage(void *info)
+{
+    delete static_cast<poppler::image*>(info);
+}
+
+
+static void releaseQImage(void *info)
+{
+    delete static_cast<QImage*>(info);
+}
+
 
+/************************************************
+ Returns the part of the image without copying the
+ pixels. The result holds a reference to the image.
+ ************************************************/
+static QImage subImage(const QImage &img, const QRect &rect)
+{
+    QRect r = rect & img.rect();
+    if (r.isEmpty())
+        return QImage();
+
+    if (img.depth() < 8)
+        return img.copy(r);
+
+    QImage *keeper = new QImage(img);
+    const uchar *data = keeper->constBits() +
+                        r.top()  * keeper->bytesPerLine() +
+                        r.left() * (keeper->depth() / 8);
+
+    return QImage(data, r.width(), r.height(), keeper->bytesPerLine(), keeper->format(),
+                  releaseQImage, keeper);
+}
+
+
+/************************************************
+ The QImage adopts the poppler buffer, so the pixels
+ are allocated only once, by the poppler.
  ************************************************/
 QImage doRenderSheet(poppler::document *doc, int sheetNum, double resolution)
 {
@@ -47,11 +90,11 @@ QImage doRenderSheet(poppler::document *doc, int sheetNum, double resolution)
         prender.set_render_hint(poppler::page_renderer::antialiasing, true);
         prender.set_render_hint(poppler::page_renderer::text_antialiasing, true);
 
-        poppler::image img = prender.render_page(page, resolution, resolution);
+        poppler::image *img = new poppler::image(prender.render_page(page, resolution, resolution));
 
         QImage::Format format = QImage::Format_Invalid;
 
-        switch (img.format())
+        switch (img->format())
         {
         case poppler::image::format_invalid: format = QImage::Format_Invalid; break;
         case poppler::image::format_mono:    format = QImage::Format_Mono;    break;
@@ -63,10 +106,15 @@ QImage doRenderSheet(poppler::document *doc, int sheetNum, double resolution)
         QImage result;
         if (format != QImage::Format_Invalid)
         {
-            result = QImage(reinterpret_cast<const uchar*>(img.const_data()),
-                            img.width(), img.height(),
-                            img.bytes_per_row(),
-                            format).copy();
+            result = QImage(reinterpret_cast<const uchar*>(img->const_data()),
+                            img->width(), img->height(),
+                            img->bytes_per_row(),
+                            format,
+                            releasePopplerImage, img);
+        }
+        else
+        {
+            delete img;
         }
 
         delete page;
@@ -80,15 +128,12 @@ QImage doRenderSheet(poppler::document *doc, int sheetNum, double resolution)
 /************************************************
  *
  ************************************************/
-RenderWorker::RenderWorker(const QString &fileName, int resolution):
+RenderWorker::RenderWorker(int resolution, const QAtomicInt *generation):
     QObject(),
-    mSheetNum(0),
     mResolution(resolution),
-    mBusy(false),
+    mLatestGeneration(generation),
     mPopplerDoc(0)
 {
-    if (QFileInfo(fileName).exists())
-        mPopplerDoc = poppler::document::load_from_file(fileName.toLocal8Bit().data());
 }
 
 
@@ -104,33 +149,64 @@ RenderWorker::~RenderWorker()
 /************************************************
  *
  ************************************************/
-QImage RenderWorker::renderSheet(int sheetNum)
+bool RenderWorker::isObsolete(const RenderSnapshotPtr &snapshot) const
 {
-    if (!mPopplerDoc)
-        return QImage();
+    return snapshot != mSnapshot || snapshot->generation != mLatestGeneration->load();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void RenderWorker::setDocument(const RenderSnapshotPtr &snapshot)
+{
+    // The file was changed again while this request was in the queue.
+    if (snapshot->generation != mLatestGeneration->load())
+        return;
+
+    delete mPopplerDoc;
+    mPopplerDoc = 0;
+    mSnapshot = snapshot;
 
-    mBusy = true;
-    QImage img = doRenderSheet(mPopplerDoc, sheetNum, mResolution);
-    emit sheetReady(img, sheetNum);
-    mBusy = false;
-    return img;
+    if (QFileInfo(snapshot->fileName).exists())
+        mPopplerDoc = poppler::document::load_from_file(snapshot->fileName.toLocal8Bit().data());
 }
 
 
 /************************************************
  *
  ************************************************/
-QImage RenderWorker::renderPage(int sheetNum, const QRectF &pageRect, int pageNum)
+void RenderWorker::renderSheet(int sheetNum, const RenderSnapshotPtr &snapshot)
 {
-    if (!mPopplerDoc)
-        return QImage();
+    if (mPopplerDoc && !isObsolete(snapshot))
+    {
+        QImage img = doRenderSheet(mPopplerDoc, sheetNum, mResolution);
+        emit sheetReady(img, sheetNum, snapshot->generation);
+    }
 
-    mBusy = true;
-    QImage img = doRenderSheet(mPopplerDoc, sheetNum, mResolution);
+    emit finished();
+}
 
-    QSizeF printerSize =  project->printer()->paperRect().size();
 
-    if (isLandscape(project->rotation()))
+/************************************************
+ *
+ ************************************************/
+void RenderWorker::renderPage(int pageNum, const RenderSnapshotPtr &snapshot)
+{
+    if (!mPopplerDoc || isObsolete(snapshot) || !snapshot->pages.contains(pageNum))
+    {
+        emit finished();
+        return;
+    }
+
+    RenderSnapshot::PagePlace place = snapshot->pages.value(pageNum);
+    const QRectF &pageRect = place.rect;
+    bool landscape = isLandscape(snapshot->rotation);
+
+    QImage img = doRenderSheet(mPopplerDoc, place.sheetNum, mResolution);
+    QSizeF printerSize = snapshot->paperSize;
+
+    if (landscape)
         printerSize.transpose();
 
     double scale = qMin(img.width() * 1.0 / printerSize.width(),
@@ -139,11 +215,11 @@ QImage RenderWorker::renderPage(int sheetNum, const QRectF &pageRect, int pageNu
     QSize size = QSize(pageRect.width()  * scale,
                        pageRect.height() * scale);
 
-    if (isLandscape(project->rotation()))
+    if (landscape)
         size.transpose();
 
     QRect rect(QPoint(0, 0), size);
-    if (isLandscape(project->rotation()))
+    if (landscape)
     {
         rect.moveRight(img.width() - pageRect.top()  * scale);
         rect.moveTop(pageRect.left() * scale);
@@ -154,11 +230,10 @@ QImage RenderWorker::renderPage(int sheetNum, const QRectF &pageRect, int pageNu
         rect.moveTop(pageRect.top()  * scale);
     }
 
-    img = img.copy(rect);
+    img = subImage(img, rect);
 
-    emit pageReady(img, pageNum);
-    mBusy = false;
-    return img;
+    emit pageReady(img, pageNum, snapshot->generation);
+    emit finished();
 }
 
 
@@ -167,10 +242,37 @@ QImage RenderWorker::renderPage(int sheetNum, const QRectF &pageRect, int pageNu
  ************************************************/
 Render::Render(double resolution, int threadCount, QObject *parent):
     QObject(parent),
+    mGeneration(0),
     mResolution(resolution),
     mThreadCount(threadCount)
 {
+    qRegisterMetaType<RenderSnapshotPtr>();
+
+    RenderSnapshot *snapshot = new RenderSnapshot();
+    snapshot->generation = 0;
+    snapshot->rotation = NoRotate;
+    mSnapshot = RenderSnapshotPtr(snapshot);
+
     mWorkers.reserve(threadCount);
+    for (int i=0; i<threadCount; ++i)
+    {
+        RenderWorker *worker = new RenderWorker(mResolution, &mGeneration);
+        mWorkers << worker;
+
+        connect(worker, SIGNAL(sheetReady(QImage,int,int)),
+                this, SLOT(workerSheetReady(QImage,int,int)));
+
+        connect(worker, SIGNAL(pageReady(QImage,int,int)),
+                this, SLOT(workerPageReady(QImage,int,int)));
+
+        connect(worker, SIGNAL(finished()),
+                this, SLOT(workerFinished()));
+
+        worker->moveToThread(worker->thread());
+        worker->thread()->start();
+    }
+
+    mIdleWorkers = mWorkers;
 }
 
 
@@ -179,6 +281,9 @@ Render::Render(double resolution, int threadCount, QObject *parent):
  ************************************************/
 Render::~Render()
 {
+    // Workers skip the requests that are left in their queues.
+    mGeneration.fetchAndAddOrdered(1);
+
     foreach (RenderWorker *worker, mWorkers)
     {
         worker->thread()->quit();
@@ -189,42 +294,62 @@ Render::~Render()
 
 
 /************************************************
- *
+ * Doesn't wait for the workers. The requests for
+ * the old file that are still queued in the worker
+ * threads are skipped, and their results dropped.
  ************************************************/
 void Render::setFileName(const QString &fileName)
 {
     mFileName = fileName;
+    mQueue.clear();
 
-    foreach(RenderWorker *worker, mWorkers)
+    RenderSnapshot *snapshot = new RenderSnapshot();
+    snapshot->generation = mGeneration.fetchAndAddOrdered(1) + 1;
+    snapshot->fileName   = fileName;
+    snapshot->paperSize  = project->printer()->paperRect().size();
+    snapshot->rotation   = project->rotation();
+
+    const SheetList &sheets = project->previewSheets();
+    snapshot->pages.reserve(project->pageCount());
+    for (int s=0; s<sheets.count(); ++s)
     {
-        worker->thread()->quit();
-        worker->thread()->wait();
-        delete worker;
+        const Sheet *sheet = sheets.at(s);
+        for (int i=0; i<sheet->count(); ++i)
+        {
+            const ProjectPage *page = sheet->page(i);
+            if (!page || snapshot->pages.contains(page->pageNum()))
+                continue;
+
+            RenderSnapshot::PagePlace place;
+            place.sheetNum = s;
+            place.rect = project->layout()->transformSpec(sheet, i, snapshot->rotation).rect;
+            snapshot->pages.insert(page->pageNum(), place);
+        }
     }
 
-    mWorkers.resize(mThreadCount);
+    mSnapshot = RenderSnapshotPtr(snapshot);
 
-    for (int i=0; i<mWorkers.count(); ++i)
+    foreach(RenderWorker *worker, mWorkers)
     {
-        RenderWorker *worker = new RenderWorker(fileName, mResolution);
-        mWorkers[i] = worker;
-
-        connect(worker, SIGNAL(sheetReady(QImage,int)),
-                this, SIGNAL(sheetReady(QImage,int)));
-
-        connect(worker, SIGNAL(sheetReady(QImage,int)),
-                this, SLOT(workerFinished()));
-
-        connect(worker, SIGNAL(pageReady(QImage,int)),
-                this, SIGNAL(pageReady(QImage,int)));
+        QMetaObject::invokeMethod(worker,
+                                  "setDocument",
+                                  Qt::QueuedConnection,
+                                  Q_ARG(RenderSnapshotPtr, mSnapshot));
+    }
+}
 
-        connect(worker, SIGNAL(pageReady(QImage,int)),
-                this, SLOT(workerFinished()));
 
+/************************************************
+ *
+ ************************************************/
+RenderWorker *Render::takeIdleWorker()
+{
+    if (mIdleWorkers.isEmpty())
+        return nullptr;
 
-        worker->moveToThread(worker->thread());
-        worker->thread()->start();
-    }
+    RenderWorker *worker = mIdleWorkers.last();
+    mIdleWorkers.removeLast();
+    return worker;
 }
 
 
@@ -233,13 +358,11 @@ void Render::setFileName(const QString &fileName)
  ************************************************/
 void Render::renderSheet(int sheetNum)
 {
-    foreach (RenderWorker *worker, mWorkers)
+    RenderWorker *worker = takeIdleWorker();
+    if (worker)
     {
-        if (!worker->isBusy())
-        {
-            startRenderSheet(worker, sheetNum);
-            return;
-        }
+        startRenderSheet(worker, sheetNum);
+        return;
     }
 
     QPair<int,bool> job(sheetNum, false);
@@ -248,18 +371,36 @@ void Render::renderSheet(int sheetNum)
 }
 
 
+/************************************************
+ * Unlike renderSheet, the request is placed at the
+ * end of the queue, so the prefetch requests are
+ * processed in the order they were made.
+ ************************************************/
+void Render::prefetchSheet(int sheetNum)
+{
+    RenderWorker *worker = takeIdleWorker();
+    if (worker)
+    {
+        startRenderSheet(worker, sheetNum);
+        return;
+    }
+
+    QPair<int,bool> job(sheetNum, false);
+    if (!mQueue.contains(job))
+        mQueue.append(job);
+}
+
+
 /************************************************
  *
  ************************************************/
 void Render::renderPage(int pageNum)
 {
-    foreach (RenderWorker *worker, mWorkers)
+    RenderWorker *worker = takeIdleWorker();
+    if (worker)
     {
-        if (!worker->isBusy())
-        {
-            startRenderPage(worker, pageNum);
-            return;
-        }
+        startRenderPage(worker, pageNum);
+        return;
     }
 
     QPair<int,bool> job(pageNum, true);
@@ -272,9 +413,9 @@ void Render::renderPage(int pageNum)
 /************************************************
  *
  ************************************************/
-void Render::cancelSheet(int sheetNum)
+bool Render::cancelSheet(int sheetNum)
 {
-    mQueue.removeAll(QPair<int,bool>(sheetNum, false));
+    return mQueue.removeAll(QPair<int,bool>(sheetNum, false)) > 0;
 }
 
 
@@ -287,20 +428,63 @@ void Render::cancelPage(int pageNum)
 }
 
 
+/************************************************
+ *
+ ************************************************/
+void Render::workerSheetReady(const QImage &img, int sheetNum, int generation)
+{
+    if (generation == mGeneration.load())
+        emit sheetReady(img, sheetNum);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void Render::workerPageReady(const QImage &img, int pageNum, int generation)
+{
+    if (generation == mGeneration.load())
+        emit pageReady(img, pageNum);
+}
+
+
 /************************************************
  *
  ************************************************/
 void Render::workerFinished()
 {
-    if (!mQueue.isEmpty())
+    RenderWorker *worker = qobject_cast<RenderWorker*>(sender());
+    if (!worker)
+        return;
+
+    startNextJob(worker);
+}
+
+
+/************************************************
+ * The page jobs for the pages that are not in the
+ * snapshot are dropped, the worker takes the next
+ * job, so the rest of the queue doesn't stall.
+ ************************************************/
+void Render::startNextJob(RenderWorker *worker)
+{
+    while (!mQueue.isEmpty())
     {
-        RenderWorker *worker = qobject_cast<RenderWorker*>(sender());
         QPair<int,bool> job = mQueue.takeFirst();
         if (!job.second)
+        {
             startRenderSheet(worker, job.first);
-        else
+            return;
+        }
+
+        if (mSnapshot->pages.contains(job.first))
+        {
             startRenderPage(worker, job.first);
+            return;
+        }
     }
+
+    mIdleWorkers << worker;
 }
 
 
@@ -312,7 +496,8 @@ void Render::startRenderSheet(RenderWorker *worker, int sheetNum)
     QMetaObject::invokeMethod(worker,
                               "renderSheet",
                               Qt::QueuedConnection,
-                              Q_ARG(int, sheetNum));
+                              Q_ARG(int, sheetNum),
+                              Q_ARG(RenderSnapshotPtr, mSnapshot));
 }
 
 
@@ -321,31 +506,17 @@ void Render::startRenderSheet(RenderWorker *worker, int sheetNum)
  ************************************************/
 void Render::startRenderPage(RenderWorker *worker, int pageNum)
 {
-    int sheetNum = project->previewSheets().indexOfPage(pageNum);
-    if (sheetNum < 0)
-        return;
-
-    Sheet *sheet = project->previewSheets().at(sheetNum);
-    ProjectPage *page = project->page(pageNum);
-
-    int pageOnSheet = -1;
-    for (int i = 0; i<sheet->count(); ++i)
+    if (!mSnapshot->pages.contains(pageNum))
     {
-        if (sheet->page(i) == page)
-            pageOnSheet = i;
-    }
-
-    if (pageOnSheet < 0)
+        startNextJob(worker);
         return;
-
-    TransformSpec spec = project->layout()->transformSpec(sheet, pageOnSheet, project->rotation());
+    }
 
     QMetaObject::invokeMethod(worker,
                               "renderPage",
                               Qt::QueuedConnection,
-                              Q_ARG(int, sheetNum),
-                              Q_ARG(QRectF, spec.rect),
-                              Q_ARG(int, pageNum));
+                              Q_ARG(int, pageNum),
+                              Q_ARG(RenderSnapshotPtr, mSnapshot));
 }
 
 
@@ -32,39 +32,75 @@
 #include <QThread>
 #include <QList>
 #include <QPair>
+#include <QVector>
+#include <QAtomicInt>
+#include <QHash>
+#include <QRectF>
+#include <QSharedData>
+#include <QExplicitlySharedDataPointer>
+#include "boomagatypes.h"
 
 namespace poppler
 {
     class document;
 }
 
+/// The state of the project the render requests depend on. It's made in the
+/// GUI thread when the file is changed and is never modified after that,
+/// so the workers share it without locking and don't touch the project.
+class RenderSnapshot: public QSharedData
+{
+public:
+    struct PagePlace
+    {
+        int    sheetNum;
+        QRectF rect;
+    };
+
+    int      generation;
+    QString  fileName;
+    QSizeF   paperSize;
+    Rotation rotation;
+    QHash<int, PagePlace> pages;
+};
+
+typedef QExplicitlySharedDataPointer<const RenderSnapshot> RenderSnapshotPtr;
+Q_DECLARE_METATYPE(RenderSnapshotPtr)
+
+
 class RenderWorker: public QObject
 {
     Q_OBJECT
 public:
-    explicit RenderWorker(const QString &fileName, int resolution);
+    explicit RenderWorker(int resolution, const QAtomicInt *generation);
     virtual ~RenderWorker();
 
-    bool isBusy() const { return mBusy; }
     QThread *thread() { return &mThread; }
 
 public slots:
-    QImage renderSheet(int sheetNum);
-    QImage renderPage(int sheetNum, const QRectF &pageRect, int pageNum);
+    void setDocument(const RenderSnapshotPtr &snapshot);
+    void renderSheet(int sheetNum, const RenderSnapshotPtr &snapshot);
+    void renderPage(int pageNum, const RenderSnapshotPtr &snapshot);
 
 signals:
-    void sheetReady(QImage, int sheetNum);
-    void pageReady(QImage, int pageNum);
+    void sheetReady(QImage, int sheetNum, int generation);
+    void pageReady(QImage, int pageNum, int generation);
+    void finished();
 
 private:
-    int mSheetNum;
     int mResolution;
-    bool mBusy;
+    RenderSnapshotPtr mSnapshot;
+    const QAtomicInt *mLatestGeneration;
     QThread mThread;
     poppler::document *mPopplerDoc;
+
+    bool isObsolete(const RenderSnapshotPtr &snapshot) const;
 };
 
 
+/// The worker threads live as long as the Render. When the file is
+/// changed, every worker loads the new document in its own thread, and
+/// the requests and results of the older documents are dropped.
 class Render : public QObject
 {
     Q_OBJECT
@@ -78,7 +114,8 @@ public slots:
     void setFileName(const QString &fileName);
 
     void renderSheet(int sheetNum);
-    void cancelSheet(int sheetNum);
+    void prefetchSheet(int sheetNum);
+    bool cancelSheet(int sheetNum);
 
     void renderPage(int pageNum);
     void cancelPage(int pageNum);
@@ -88,17 +125,24 @@ signals:
     void pageReady(QImage, int pageNum);
 
 private slots:
+    void workerSheetReady(const QImage &img, int sheetNum, int generation);
+    void workerPageReady(const QImage &img, int pageNum, int generation);
     void workerFinished();
 
 private:
     QString mFileName;
+    RenderSnapshotPtr mSnapshot;
     QVector<RenderWorker*> mWorkers;
+    QVector<RenderWorker*> mIdleWorkers;
+    QAtomicInt mGeneration;
     int mResolution;
     int mThreadCount;
     QList<QPair<int, bool> > mQueue;
 
+    RenderWorker *takeIdleWorker();
     void startRenderSheet(RenderWorker *worker, int sheetNum);
     void startRenderPage(RenderWorker *worker, int pageNum);
+    void startNextJob(RenderWorker *worker);
 
 };
 
@@ -0,0 +1,433 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#include "service.h"
+#include "spoolwatcher.h"
+#include "dbus.h"
+#include "kernel/project.h"
+#include "boomagatypes.h"
+#include "../common.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDBusConnection>
+#include <QDBusServiceWatcher>
+#include <QFile>
+#include <QFileInfo>
+#include <QTimer>
+
+#include <unistd.h>
+
+static const char * const TAKE_COMMAND = "TAKE";
+static const char * const SAVE_COMMAND = "SAVE";
+static const char * const DONE_COMMAND = "DONE";
+static const char * const EMPTY_REPLY  = "EMPTY";
+static const char * const FILE_REPLY   = "FILE ";
+static const int ATTACH_TIMEOUT = 30 * 1000;
+
+
+/************************************************
+ *
+ ************************************************/
+BoomagaService::BoomagaService(QObject *parent):
+    QObject(parent),
+    mServer(new QLocalServer(this)),
+    mSpoolWatcher(nullptr),
+    mDbus(nullptr)
+{
+    // The exiting GUI can still own the name when the service starts again.
+    QDBusServiceWatcher *watcher = new QDBusServiceWatcher("org.boomaga",
+                                                           QDBusConnection::sessionBus(),
+                                                           QDBusServiceWatcher::WatchForUnregistration,
+                                                           this);
+    connect(watcher, &QDBusServiceWatcher::serviceUnregistered,
+            this, &BoomagaService::registerDbusName);
+
+    project->setInteractive(false);
+
+    mServer->setSocketOptions(QLocalServer::UserAccessOption);
+    QLocalServer::removeServer(serverName());
+    if (!mServer->listen(serverName()))
+    {
+        Log::error("Can't listen on %s: %s",
+                   serverName().toLocal8Bit().data(),
+                   mServer->errorString().toLocal8Bit().data());
+    }
+
+    connect(mServer, &QLocalServer::newConnection,
+            this, &BoomagaService::newConnection);
+
+    start();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+BoomagaService::~BoomagaService()
+{
+    pause();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QString BoomagaService::serverName()
+{
+    return QString("boomaga-%1").arg(getuid());
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void BoomagaService::start()
+{
+    if (!mDbus)
+        mDbus = new BoomagaDbus("org.boomaga", "/boomaga");
+
+    registerDbusName();
+
+    if (!mSpoolWatcher)
+    {
+        mSpoolWatcher = new SpoolWatcher(this);
+        connect(mDbus, &BoomagaDbus::fileReceived,
+                mSpoolWatcher, &SpoolWatcher::load);
+        mSpoolWatcher->addDir(SpoolWatcher::defaultDir());
+    }
+
+    Log::debug("Service started");
+}
+
+
+/************************************************
+ * Asking for the name we already own is harmless,
+ * so it's simply requested again when the name
+ * is released by anyone.
+ ************************************************/
+void BoomagaService::registerDbusName()
+{
+    if (!mDbus)
+        return;
+
+    if (!QDBusConnection::sessionBus().registerService("org.boomaga"))
+        Log::debug("The D-Bus name is owned by another process, waiting until it's released");
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void BoomagaService::pause()
+{
+    delete mSpoolWatcher;
+    mSpoolWatcher = nullptr;
+
+    if (mDbus)
+    {
+        QDBusConnection::sessionBus().unregisterObject("/boomaga");
+        QDBusConnection::sessionBus().unregisterService("org.boomaga");
+        delete mDbus;
+        mDbus = nullptr;
+    }
+
+    Log::debug("Service paused");
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void BoomagaService::newConnection()
+{
+    QLocalSocket *socket = mServer->nextPendingConnection();
+    if (!socket)
+        return;
+
+    if (mClient)
+    {
+        // Only one GUI can own the jobs.
+        socket->write(EMPTY_REPLY);
+        socket->write("\n");
+        socket->disconnectFromServer();
+        socket->deleteLater();
+        return;
+    }
+
+    // The commands are read when they come, the service
+    // keeps receiving the jobs in the meantime.
+    connect(socket, &QLocalSocket::readyRead,
+            this, [this, socket]() { readCommands(socket); });
+
+    connect(socket, &QLocalSocket::disconnected,
+            socket, &QLocalSocket::deleteLater);
+
+    QTimer::singleShot(ATTACH_TIMEOUT, socket, [this, socket]() {
+        if (socket != mClient)
+            socket->disconnectFromServer();
+    });
+
+    readCommands(socket);
+}
+
+
+/************************************************
+ * The first command of the client is TAKE, the
+ * jobs stay in the project until the client sends
+ * DONE. SAVE asks for the project file if the
+ * client can't read the merged file.
+ ************************************************/
+void BoomagaService::readCommands(QLocalSocket *socket)
+{
+    while (socket->canReadLine())
+    {
+        QByteArray cmd = socket->readLine().trimmed();
+
+        if (socket != mClient)
+        {
+            if (mClient || cmd != TAKE_COMMAND)
+            {
+                socket->disconnectFromServer();
+                return;
+            }
+
+            mClient = socket;
+            connect(socket, &QLocalSocket::disconnected,
+                    this, &BoomagaService::clientDisconnected);
+
+            // The GUI will watch the spool directory itself.
+            pause();
+            reply(socket, handOverProject());
+            continue;
+        }
+
+        if (cmd == SAVE_COMMAND)
+        {
+            reply(socket, saveProject());
+            continue;
+        }
+
+        if (cmd == DONE_COMMAND)
+        {
+            finishHandOff();
+            continue;
+        }
+    }
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void BoomagaService::reply(QLocalSocket *socket, const QString &file)
+{
+    if (file.isEmpty())
+        socket->write(EMPTY_REPLY);
+    else
+        socket->write(FILE_REPLY + file.toLocal8Bit());
+
+    socket->write("\n");
+    socket->flush();
+}
+
+
+/************************************************
+ * If the client is gone without confirming the
+ * hand-off, the jobs are still ours.
+ ************************************************/
+void BoomagaService::clientDisconnected()
+{
+    if (!mHandOffFile.isEmpty())
+    {
+        Log::warn("The GUI has not taken the jobs, they are kept");
+        QFile::remove(mergedFileName(mHandOffFile));
+        QFile::remove(mHandOffFile);
+        mHandOffFile.clear();
+    }
+
+    mClient = nullptr;
+    start();
+}
+
+
+/************************************************
+ * The project file is written only if the merged
+ * state can't be handed over, it's a full copy of
+ * all the jobs.
+ ************************************************/
+QString BoomagaService::handOverProject()
+{
+    if (project->jobs()->isEmpty())
+        return "";
+
+    mHandOffFile = genTmpFileName(".boo");
+    if (project->saveMerged(mergedFileName(mHandOffFile)))
+        return mHandOffFile;
+
+    Log::warn("Can't hand over the merged file, the GUI will merge the jobs again");
+    return saveProject();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QString BoomagaService::saveProject()
+{
+    if (mHandOffFile.isEmpty())
+        return "";
+
+    try
+    {
+        project->save(mHandOffFile);
+        return mHandOffFile;
+    }
+    catch (const BoomagaError &err)
+    {
+        Log::error("Can't save project: %s", err.what());
+    }
+    catch (const QString &err)
+    {
+        Log::error("Can't save project: %s", err.toLocal8Bit().data());
+    }
+
+    QFile::remove(mHandOffFile);
+    mHandOffFile.clear();
+    return "";
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void BoomagaService::finishHandOff()
+{
+    if (mHandOffFile.isEmpty())
+        return;
+
+    QFile::remove(mergedFileName(mHandOffFile));
+    QFile::remove(mHandOffFile);
+    mHandOffFile.clear();
+
+    project->releaseMerged();
+    project->removeAllJobs();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+static QString readReply(QLocalSocket *socket)
+{
+    while (!socket->canReadLine())
+    {
+        if (!socket->waitForReadyRead(ATTACH_TIMEOUT))
+            return "";
+    }
+
+    QString reply = QString::fromLocal8Bit(socket->readLine()).trimmed();
+    if (!reply.startsWith(FILE_REPLY))
+        return "";
+
+    return reply.mid(strlen(FILE_REPLY));
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QString BoomagaService::attach(QLocalSocket *socket)
+{
+    socket->connectToServer(serverName());
+    if (!socket->waitForConnected(1000))
+        return "";
+
+    socket->write(TAKE_COMMAND);
+    socket->write("\n");
+    socket->flush();
+
+    return readReply(socket);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QString BoomagaService::requestProjectFile(QLocalSocket *socket)
+{
+    if (socket->state() != QLocalSocket::ConnectedState)
+        return "";
+
+    socket->write(SAVE_COMMAND);
+    socket->write("\n");
+    socket->flush();
+
+    return readReply(socket);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QString BoomagaService::takeProjectFile(const QString &fileName)
+{
+    if (fileName.isEmpty())
+        return "";
+
+    QString res = genTmpFileName(".boo");
+    if (::link(QFile::encodeName(fileName).constData(), QFile::encodeName(res).constData()) == 0 ||
+        QFile::copy(fileName, res))
+    {
+        return res;
+    }
+
+    Log::error("Can't take the project file %s", fileName.toLocal8Bit().data());
+    return "";
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void BoomagaService::confirm(QLocalSocket *socket)
+{
+    if (socket->state() != QLocalSocket::ConnectedState)
+        return;
+
+    socket->write(DONE_COMMAND);
+    socket->write("\n");
+    socket->waitForBytesWritten(1000);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QString BoomagaService::mergedFileName(const QString &projectFile)
+{
+    return projectFile + ".merged";
+}
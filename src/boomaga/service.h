@@ -0,0 +1,109 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include <QObject>
+#include <QPointer>
+
+class QLocalServer;
+class QLocalSocket;
+class SpoolWatcher;
+class BoomagaDbus;
+
+/// The headless boomaga, started with the --service option.
+///
+/// The service receives the jobs from the backend, both via the spool
+/// directory and via D-Bus, and loads them into the project. So the
+/// PostScript conversion, parsing and merging are done before the user
+/// opens the window.
+///
+/// When the GUI starts, it attaches to the service over the local socket
+/// and takes over the project. The service hands over the merged tmp PDF
+/// with the page info (see mergedFileName()), so the GUI neither parses nor
+/// merges the jobs again. The project file is written only if the merged
+/// state can't be used. The service keeps the jobs until the GUI confirms
+/// it loaded them, if the GUI is gone before that, the jobs stay in the
+/// service. While the GUI is attached the service releases the spool
+/// directory and the D-Bus name, when the GUI exits the service continues
+/// to collect the jobs.
+class BoomagaService: public QObject
+{
+    Q_OBJECT
+public:
+    explicit BoomagaService(QObject *parent = nullptr);
+    ~BoomagaService();
+
+    /// Returns the name of the local socket of the current user.
+    static QString serverName();
+
+    /// Attaches the GUI to the running service. Returns the name of the
+    /// project file with the jobs collected by the service, an empty string
+    /// if the service isn't running or has no jobs. Only the merged file
+    /// (see mergedFileName()) may exist, use requestProjectFile() if it
+    /// can't be loaded. The socket should be kept open as long as the GUI runs.
+    static QString attach(QLocalSocket *socket);
+
+    /// Asks the service to write the project file, if the merged file
+    /// returned by attach() can't be used. Returns the file name or an
+    /// empty string on error.
+    static QString requestProjectFile(QLocalSocket *socket);
+
+    /// The jobs of the loaded project refer to the project file, so it's
+    /// linked under our own name before loading. Returns the new name
+    /// or an empty string on error.
+    static QString takeProjectFile(const QString &fileName);
+
+    /// Tells the service that the jobs were loaded, so it removes them.
+    static void confirm(QLocalSocket *socket);
+
+    /// Returns the name of the file with the merged state, which is written
+    /// next to the project file returned by attach(). See Project::loadMerged().
+    static QString mergedFileName(const QString &projectFile);
+
+private slots:
+    void newConnection();
+    void clientDisconnected();
+    void registerDbusName();
+
+private:
+    QLocalServer *mServer;
+    QPointer<QLocalSocket> mClient;
+    SpoolWatcher *mSpoolWatcher;
+    BoomagaDbus  *mDbus;
+    QString mHandOffFile;
+
+    void start();
+    void pause();
+    void readCommands(QLocalSocket *socket);
+    void reply(QLocalSocket *socket, const QString &file);
+    QString handOverProject();
+    QString saveProject();
+    void finishHandOff();
+};
+
+#endif // SERVICE_H
@@ -28,6 +28,9 @@
 #include <QDir>
 #include <QDebug>
 #include <QStandardPaths>
+#include <QMutex>
+#include <QRunnable>
+#include <QMetaEnum>
 
 
 #define MAINWINDOW_GROUP "MainWindow"
@@ -38,6 +41,40 @@
 
 QString Settings::mFileName;
 
+static const int FLUSH_DELAY = 500;
+
+/************************************************
+
+ ************************************************/
+class SettingsWriter: public QRunnable
+{
+public:
+    SettingsWriter(const QString &fileName, QSettings::Format format, const QHash<QString, QVariant> &values):
+        mFileName(fileName),
+        mFormat(format),
+        mValues(values)
+    {
+    }
+
+    void run() override
+    {
+        static QMutex mutex;
+        QMutexLocker locker(&mutex);
+
+        QSettings out(mFileName, mFormat);
+        for (auto it = mValues.constBegin(); it != mValues.constEnd(); ++it)
+            out.setValue(it.key(), it.value());
+
+        out.sync();
+    }
+
+private:
+    QString mFileName;
+    QSettings::Format mFormat;
+    QHash<QString, QVariant> mValues;
+};
+
+
 /************************************************
 
  ************************************************/
@@ -91,7 +128,7 @@ Settings::Settings(const QString &fileName):
  ************************************************/
 Settings::~Settings()
 {
-
+    sync();
 }
 
 /************************************************
@@ -165,6 +202,17 @@ QString Settings::keyToString(Settings::Key key) const
  ************************************************/
 void Settings::init()
 {
+    mWriter.setMaxThreadCount(1);
+    mFlushTimer.setSingleShot(true);
+    mFlushTimer.setInterval(FLUSH_DELAY);
+    connect(&mFlushTimer, &QTimer::timeout, this, &Settings::flush);
+
+    // The names are built once, value() is called for every profile field.
+    QMetaEnum keys = QMetaEnum::fromType<Key>();
+    mKeyNames.resize(keys.keyCount());
+    for (int i=0; i<keys.keyCount(); ++i)
+        mKeyNames[keys.value(i)] = keyToString(Key(keys.value(i)));
+
     setIniCodec("UTF-8");
     setDefaultValue(Layout,   "1up");
     setDefaultValue(DoubleSided, true);
@@ -183,6 +231,12 @@ void Settings::init()
     dir = shrinkHomeDir(dir);
     setDefaultValue(AutoSaveDir, QDir(dir).filePath("Boomaga files"));
 
+    mSnapshot.rightToLeft          = value(RightToLeft).toBool();
+    mSnapshot.subBookletsEnabled   = value(SubBookletsEnabled).toBool();
+    mSnapshot.subBookletSize       = value(SubBookletSize).toInt();
+    mSnapshot.allowNegativeMargins = value(AllowNegativeMargins).toBool();
+    mSnapshot.autoSave             = value(AutoSave).toBool();
+    mSnapshot.doubleSided          = value(DoubleSided).toBool();
 }
 
 
@@ -209,16 +263,29 @@ void Settings::setDefaultValue(Settings::Key key, const QVariant &defaultValue)
  ************************************************/
 QVariant Settings::value(Settings::Key key, const QVariant &defaultValue) const
 {
-    return value(keyToString(key), defaultValue);
+    return value(keyName(key), defaultValue);
 }
 
 
 /************************************************
-
+ The values inside the groups and arrays (printer
+ profiles) are cached by the fully qualified key.
  ************************************************/
 QVariant Settings::value(const QString &key, const QVariant &defaultValue) const
 {
-    return QSettings::value(key, defaultValue);
+    QString prefix = group();
+    QString fullKey = prefix.isEmpty() ? key : prefix + "/" + key;
+
+    auto it = mCache.constFind(fullKey);
+    if (it == mCache.constEnd())
+    {
+        if (!contains(key))
+            return defaultValue;
+
+        it = mCache.insert(fullKey, QSettings::value(key));
+    }
+
+    return it.value();
 }
 
 
@@ -227,7 +294,14 @@ QVariant Settings::value(const QString &key, const QVariant &defaultValue) const
  ************************************************/
 void Settings::setValue(Settings::Key key, const QVariant &value)
 {
-    setValue(keyToString(key), value);
+    const QString &k = keyName(key);
+    if (group().isEmpty() && mCache.contains(k) && mCache.value(k) == value)
+        return;
+
+    setValue(k, value);
+
+    if (group().isEmpty())
+        updateSnapshot(key, value);
 }
 
 
@@ -236,8 +310,60 @@ void Settings::setValue(Settings::Key key, const QVariant &value)
  ************************************************/
 void Settings::setValue(const QString &key, const QVariant &value)
 {
-    QSettings::setValue(key, value);
+    // The arrays are written by the QSettings at once,
+    // it keeps their sizes itself.
+    QString prefix = group();
+    if (!prefix.isEmpty())
+    {
+        QSettings::setValue(key, value);
+        mCache.insert(prefix + "/" + key, value);
+        return;
+    }
+
+    mCache.insert(key, value);
+    mDirty.insert(key, value);
+    mFlushTimer.start();
 }
 
 
+/************************************************
 
+ ************************************************/
+void Settings::updateSnapshot(Settings::Key key, const QVariant &value)
+{
+    switch (key)
+    {
+    case RightToLeft:           mSnapshot.rightToLeft          = value.toBool();   break;
+    case SubBookletsEnabled:    mSnapshot.subBookletsEnabled   = value.toBool();   break;
+    case SubBookletSize:        mSnapshot.subBookletSize       = value.toInt();    break;
+    case AllowNegativeMargins:  mSnapshot.allowNegativeMargins = value.toBool();   break;
+    case AutoSave:              mSnapshot.autoSave             = value.toBool();   break;
+    case DoubleSided:           mSnapshot.doubleSided          = value.toBool();   break;
+    default:                    break;
+    }
+}
+
+
+/************************************************
+
+ ************************************************/
+void Settings::flush()
+{
+    mFlushTimer.stop();
+    if (mDirty.isEmpty())
+        return;
+
+    mWriter.start(new SettingsWriter(fileName(), format(), mDirty));
+    mDirty.clear();
+}
+
+
+/************************************************
+
+ ************************************************/
+void Settings::sync()
+{
+    flush();
+    mWriter.waitForDone();
+    QSettings::sync();
+}
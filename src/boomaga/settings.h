@@ -30,6 +30,10 @@
 #include "kernel/project.h"
 #include <QSettings>
 #include <QSet>
+#include <QHash>
+#include <QVector>
+#include <QTimer>
+#include <QThreadPool>
 #include "boomagatypes.h"
 
 class Settings : public QSettings
@@ -90,16 +94,36 @@ public:
         ExportPDF_FileName
 
     };
+    Q_ENUM(Key)
+
+    /// Typed copy of the values which are read on hot paths.
+    struct Snapshot
+    {
+        bool rightToLeft;
+        bool subBookletsEnabled;
+        int  subBookletSize;
+        bool allowNegativeMargins;
+        bool autoSave;
+        bool doubleSided;
+    };
 
     static Settings *instance();
     static void setFileName(const QString &fileName);
 
+    const Snapshot &snapshot() const { return mSnapshot; }
+
     QVariant value(Key key, const QVariant &defaultValue = QVariant()) const;
     QVariant value(const QString &key, const QVariant &defaultValue = QVariant()) const;
 
     void setValue(Key key, const QVariant &value);
     void setValue(const QString &key, const QVariant &value);
 
+    /// Writes all pending changes to the disk and waits until it's done.
+    void sync();
+
+private slots:
+    void flush();
+
 private:
     explicit Settings(const QString &organization, const QString &application);
     explicit Settings(const QString &fileName);
@@ -110,7 +134,23 @@ private:
     void setDefaultValue(Key key, const QVariant &defaultValue);
 
     QString keyToString(Key key) const;
+    const QString &keyName(Key key) const { return mKeyNames.at(key); }
+    void updateSnapshot(Key key, const QVariant &value);
     static QString mFileName;
+
+    // The values are read from the disk once and kept in memory by the fully
+    // qualified key. Changed top level values are written by the background
+    // thread a bit later, the values inside the groups are written at once.
+    // The cache is never invalidated: the keys removed with QSettings::remove()
+    // and the changes written to the file by another process are seen only
+    // after the restart. Boomaga doesn't remove the keys, and the file
+    // belongs to the running GUI.
+    mutable QHash<QString, QVariant> mCache;
+    QVector<QString> mKeyNames;
+    QHash<QString, QVariant> mDirty;
+    QTimer mFlushTimer;
+    QThreadPool mWriter;
+    Snapshot mSnapshot;
 };
 
 #define settings Settings::instance()
@@ -0,0 +1,223 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#include "spoolwatcher.h"
+#include "kernel/project.h"
+#include "../common.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <fcntl.h>
+#include <pwd.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <QSocketNotifier>
+#else
+#include <QFileSystemWatcher>
+#endif
+
+static const char * const LOCK_FILE_NAME = ".watcher.lock";
+
+
+/************************************************
+ *
+ ************************************************/
+SpoolWatcher::SpoolWatcher(QObject *parent):
+    QObject(parent)
+{
+    // Jobs often come in bursts, so we load them in one batch.
+    mScanTimer.setSingleShot(true);
+    mScanTimer.setInterval(50);
+    connect(&mScanTimer, &QTimer::timeout, this, &SpoolWatcher::scan);
+
+#ifdef Q_OS_LINUX
+    mNotifier = nullptr;
+    mInotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (mInotifyFd < 0)
+    {
+        Log::warn("Can't initialize inotify: %s", strerror(errno));
+        return;
+    }
+
+    mNotifier = new QSocketNotifier(mInotifyFd, QSocketNotifier::Read, this);
+    connect(mNotifier, &QSocketNotifier::activated, this, &SpoolWatcher::readEvents);
+#else
+    mWatcher = new QFileSystemWatcher(this);
+    connect(mWatcher, &QFileSystemWatcher::directoryChanged, this, &SpoolWatcher::readEvents);
+#endif
+}
+
+
+/************************************************
+ *
+ ************************************************/
+SpoolWatcher::~SpoolWatcher()
+{
+    // Release the locks first, so the backend starts a new
+    // boomaga process for the jobs which we don't see anymore.
+    for (int fd: mDirs)
+        close(fd);
+
+#ifdef Q_OS_LINUX
+    if (mInotifyFd > -1)
+        close(mInotifyFd);
+#endif
+}
+
+
+/************************************************
+ *
+ ************************************************/
+QString SpoolWatcher::defaultDir()
+{
+    passwd *pwd = getpwuid(getuid());
+    if (!pwd)
+        return "";
+
+    return QString("/var/cache/boomaga/%1").arg(QString::fromLocal8Bit(pwd->pw_name));
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void SpoolWatcher::addDir(const QString &dir)
+{
+    QString path = QDir(dir).canonicalPath();
+    if (path.isEmpty() || mDirs.contains(path) || !QFileInfo(path).isWritable())
+        return;
+
+#ifdef Q_OS_LINUX
+    if (mInotifyFd < 0)
+        return;
+
+    if (inotify_add_watch(mInotifyFd, path.toLocal8Bit().data(), IN_MOVED_TO | IN_CLOSE_WRITE) < 0)
+    {
+        Log::warn("Can't watch directory %s: %s", path.toLocal8Bit().data(), strerror(errno));
+        return;
+    }
+#else
+    if (!mWatcher->addPath(path))
+        return;
+#endif
+
+    QString lockFile = path + "/" + LOCK_FILE_NAME;
+    int fd = open(lockFile.toLocal8Bit().data(), O_RDWR | O_CREAT | O_CLOEXEC, 0660);
+    if (fd < 0 || flock(fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        // Another boomaga instance watches this directory.
+        if (fd > -1)
+            close(fd);
+        fd = -1;
+    }
+
+    mDirs.insert(path, fd);
+    Log::debug("Watch spool directory %s", path.toLocal8Bit().data());
+
+    // Pick up the jobs which were spooled before we started.
+    mScanTimer.start();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void SpoolWatcher::readEvents()
+{
+#ifdef Q_OS_LINUX
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    while (read(mInotifyFd, buf, sizeof(buf)) > 0)
+        ;
+#endif
+
+    if (!mScanTimer.isActive())
+        mScanTimer.start();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void SpoolWatcher::scan()
+{
+    QStringList files;
+    for (auto it = mDirs.constBegin(); it != mDirs.constEnd(); ++it)
+    {
+        // The job files are owned by the instance that holds the lock.
+        if (it.value() < 0)
+            continue;
+
+        QDir dir(it.key());
+        foreach (const QFileInfo &fi, dir.entryInfoList(QStringList() << ("*.cboo." AUTOREMOVE_EXT),
+                                                        QDir::Files, QDir::Time | QDir::Reversed))
+        {
+            if (!mLoading.contains(fi.absoluteFilePath()))
+                files << fi.absoluteFilePath();
+        }
+    }
+
+    if (!files.isEmpty())
+        loadFiles(files);
+}
+
+
+/************************************************
+ * The backend can start boomaga for the job just
+ * before the watcher takes the lock, so the startup
+ * scan may already have loaded and removed the file.
+ ************************************************/
+void SpoolWatcher::load(const QString &file)
+{
+    QFileInfo fi(file);
+    QString path = fi.exists() ? fi.canonicalFilePath() : file;
+
+    if (file.endsWith(".cboo." AUTOREMOVE_EXT))
+    {
+        addDir(fi.absolutePath());
+        if (!fi.exists())
+            return;
+    }
+
+    if (!mLoading.contains(path))
+        loadFiles(QStringList() << path);
+}
+
+
+/************************************************
+ * The project can process events while loading,
+ * so we remember the files to not load them twice.
+ ************************************************/
+void SpoolWatcher::loadFiles(const QStringList &files)
+{
+    QSet<QString> set = files.toSet();
+    mLoading += set;
+    project->load(files);
+    mLoading -= set;
+}
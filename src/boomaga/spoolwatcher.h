@@ -0,0 +1,83 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#ifndef SPOOLWATCHER_H
+#define SPOOLWATCHER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QMap>
+#include <QSet>
+#include <QTimer>
+
+class QSocketNotifier;
+class QFileSystemWatcher;
+
+/// Watches the per-user spool directories of the CUPS backend and loads
+/// the complete job files that appear there.
+///
+/// The backend writes the job under a temporary name and renames it when
+/// it's done, so only the finished files match the pattern. While the
+/// watcher holds the lock file in the directory, the backend doesn't start
+/// the second boomaga process and doesn't look for the session bus.
+class SpoolWatcher: public QObject
+{
+    Q_OBJECT
+public:
+    explicit SpoolWatcher(QObject *parent = nullptr);
+    ~SpoolWatcher();
+
+    /// Returns the spool directory of the current user, which is used by default.
+    static QString defaultDir();
+
+    QStringList dirs() const { return mDirs.keys(); }
+
+public slots:
+    void addDir(const QString &dir);
+
+    /// Loads the file received from the backend. The spool directory
+    /// of the file will be watched from now on.
+    void load(const QString &file);
+
+private slots:
+    void readEvents();
+    void scan();
+
+private:
+    void loadFiles(const QStringList &files);
+
+    QMap<QString, int> mDirs;      // dir -> lock file descriptor
+    QSet<QString> mLoading;
+    QTimer mScanTimer;
+#ifdef Q_OS_LINUX
+    int mInotifyFd;
+    QSocketNotifier *mNotifier;
+#else
+    QFileSystemWatcher *mWatcher;
+#endif
+};
+
+#endif // SPOOLWATCHER_H
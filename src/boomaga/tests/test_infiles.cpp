@@ -33,8 +33,12 @@
 #include "../iofiles/boofile.h"
 #include "../iofiles/cupsboofile.h"
 #include "../iofiles/postscriptfile.h"
+#include "../iofiles/blobstore.h"
+#include "../kernel/project.h"
 #include <QSettings>
 #include <QDir>
+#include <QFileInfo>
+#include <QDataStream>
 
 
 /************************************************
@@ -196,3 +200,201 @@ void TestBoomaga::testInFiles_data()
 
     }
 }
+
+
+/************************************************
+ *
+ ************************************************/
+void TestBoomaga::testBooFileBlobs()
+{
+    QString inFile = mDataDir + "testInFiles/04-page_spec.boo";
+    QString outDir = dir();
+    QDir(outDir).removeRecursively();
+    QDir().mkpath(outDir);
+
+    try
+    {
+        BooFile src;
+        src.load(inFile);
+        QVector<BooFile::JobRecord> records = BooFile::jobRecords(src.jobs());
+
+        BlobStore store(outDir + "/blobs");
+        BooFile::save(outDir + "/1.boo", src.metaData(), records, &store);
+        BooFile::save(outDir + "/2.boo", src.metaData(), records, &store);
+
+        // Both projects share the blobs of the same jobs.
+        QStringList blobs = QDir(store.dir()).entryList(QStringList("*.pdf"), QDir::Files);
+        QVERIFY(blobs.count() > 0);
+        QVERIFY(blobs.count() <= src.jobs().count());
+
+        BooFile res;
+        res.load(outDir + "/2.boo");
+        QCOMPARE(res.jobs().count(), src.jobs().count());
+
+        for (int j=0; j<res.jobs().count(); ++j)
+        {
+            const Job &job = res.jobs().at(j);
+            const Job &expected = src.jobs().at(j);
+
+            QCOMPARE(QFileInfo(job.fileName()).absolutePath(), store.dir());
+            QCOMPARE(job.title(false), expected.title(false));
+            QCOMPARE(job.pageCount(), expected.pageCount());
+
+            for (int p=0; p<job.pageCount(); ++p)
+            {
+                QCOMPARE(job.page(p)->jobPageNum(),       expected.page(p)->jobPageNum());
+                QCOMPARE(job.page(p)->visible(),          expected.page(p)->visible());
+                QCOMPARE(job.page(p)->manualRotation(),   expected.page(p)->manualRotation());
+            }
+        }
+
+        // The blob based project is saved again without the new blobs.
+        BooFile::save(outDir + "/3.boo", res.metaData(), BooFile::jobRecords(res.jobs()), &store);
+        QCOMPARE(QDir(store.dir()).entryList(QStringList("*.pdf"), QDir::Files), blobs);
+
+        // The referred blobs are kept, the others are removed.
+        QStringList refs = BooFile::blobFiles(outDir + "/3.boo");
+        QCOMPARE(refs.count(), res.jobs().count());
+
+        QFile::copy(store.dir() + "/" + blobs.first(), store.dir() + "/unused.pdf");
+        store.removeUnreferenced(refs);
+        QCOMPARE(QDir(store.dir()).entryList(QStringList("*.pdf"), QDir::Files), blobs);
+
+        store.removeUnreferenced(QStringList());
+        QVERIFY(QDir(store.dir()).entryList(QStringList("*.pdf"), QDir::Files).isEmpty());
+    }
+    catch (BoomagaError &err)
+    {
+        FAIL_EXCEPTION(err);
+    }
+    catch (const QString &err)
+    {
+        QFAIL(err.toLocal8Bit());
+    }
+}
+
+
+/************************************************
+ * The service and the GUI are the same process
+ * here: the state is written, the jobs are removed
+ * and the state is loaded again.
+ ************************************************/
+void TestBoomaga::testMergedHandOff()
+{
+    QString outDir = dir();
+    QDir(outDir).removeRecursively();
+    QDir().mkpath(outDir);
+    QString mergedFile = outDir + "/project.merged";
+
+    project->setInteractive(false);
+    project->load(mDataDir + "testInFiles/01-16pages.pdf");
+    QCOMPARE(project->jobs()->count(), 1);
+
+    // The state can be written only when the jobs are merged.
+    QTRY_VERIFY_WITH_TIMEOUT(project->saveMerged(mergedFile), 10000);
+
+    const Job src = project->jobs()->first();
+    QVector<PdfPageInfo> expected;
+    for (int p=0; p<src.pageCount(); ++p)
+        expected << src.page(p)->pdfInfo();
+
+    // The service keeps its tmp file until the GUI confirms the hand-off,
+    // here the same project removes it with the jobs, so it's put back.
+    QString tmpName;
+    {
+        QFile file(mergedFile);
+        QVERIFY(file.open(QFile::ReadOnly));
+        QDataStream in(&file);
+        quint32 magic, version;
+        QString author, title, subject, keywords;
+        in >> magic >> version >> author >> title >> subject >> keywords >> tmpName;
+        QCOMPARE(in.status(), QDataStream::Ok);
+    }
+    QFile::remove(outDir + "/tmp.pdf");
+    QVERIFY(QFile::copy(tmpName, outDir + "/tmp.pdf"));
+
+    project->releaseMerged();
+    project->removeAllJobs();
+    QVERIFY(project->jobs()->isEmpty());
+
+    if (!QFile::exists(tmpName))
+        QVERIFY(QFile::copy(outDir + "/tmp.pdf", tmpName));
+
+    QVERIFY(project->loadMerged(mergedFile));
+    QCOMPARE(project->jobs()->count(), 1);
+
+    const Job res = project->jobs()->first();
+    QCOMPARE(res.fileName(), src.fileName());
+    QCOMPARE(res.title(false), src.title(false));
+    QCOMPARE(res.pageCount(), expected.count());
+    for (int p=0; p<res.pageCount(); ++p)
+    {
+        PdfPageInfo info = res.page(p)->pdfInfo();
+        QCOMPARE(res.page(p)->jobPageNum(), src.page(p)->jobPageNum());
+        QCOMPARE(info.xObjNums, expected.at(p).xObjNums);
+        QCOMPARE(info.mediaBox, expected.at(p).mediaBox);
+        QCOMPARE(info.cropBox,  expected.at(p).cropBox);
+        QCOMPARE(info.rotate,   expected.at(p).rotate);
+    }
+
+    // The taken tmp file is used without merging again.
+    QVERIFY(project->saveMerged(outDir + "/again.merged"));
+
+    // The state can be loaded only into the empty project.
+    QVERIFY(!project->loadMerged(mergedFile));
+
+    project->removeAllJobs();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void TestBoomaga::testDscPageCount()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, expected);
+
+    QCOMPARE(PostScriptFile::dscPageCount(data.constData(), data.size()), expected);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void TestBoomaga::testDscPageCount_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("expected");
+
+    QTest::newRow("No comments")
+            << QByteArray("%!PS-Adobe-3.0\nshowpage\n")
+            << 0;
+
+    QTest::newRow("Pages")
+            << QByteArray("%!PS-Adobe-3.0\n%%Pages: 12\n%%EndComments\n")
+            << 12;
+
+    QTest::newRow("Pages atend")
+            << QByteArray("%!PS-Adobe-3.0\n%%Pages: (atend)\n%%EndComments\n%%Trailer\n%%Pages: 3\n%%EOF\n")
+            << 3;
+
+    QTest::newRow("Page comments")
+            << QByteArray("%!PS-Adobe-3.0\n%%Pages: 5\n%%Page: 1 1\nshowpage\n%%Page: 2 2\nshowpage\n")
+            << 2;
+
+    QTest::newRow("CR line ends")
+            << QByteArray("%!PS-Adobe-3.0\r%%Page: 1 1\rshowpage\r%%Page: 2 2\rshowpage\r%%Page: 3 3\r")
+            << 3;
+
+    QTest::newRow("Not at line start")
+            << QByteArray("%!PS-Adobe-3.0\n(%%Page: 1 1) pop\n%%Page: 1 1\n")
+            << 1;
+
+    QTest::newRow("Embedded document")
+            << QByteArray("%!PS-Adobe-3.0\n%%Page: 1 1\n"
+                          "%%BeginDocument: fig.eps\n%%Pages: 1\n%%Page: 1 1\n%%EndDocument\n"
+                          "showpage\n%%Page: 2 2\nshowpage\n")
+            << 2;
+}
+
@@ -1100,6 +1100,53 @@ void TestBoomaga::test_BooklesSplit()
     delete layout;
 }
 
+
+/************************************************
+ *
+ * ***********************************************/
+void TestBoomaga::testSettingsSnapshot()
+{
+    bool old = settings->snapshot().rightToLeft;
+    settings->setValue(Settings::RightToLeft, !old);
+    QCOMPARE(settings->snapshot().rightToLeft, !old);
+    QCOMPARE(settings->value(Settings::RightToLeft).toBool(), !old);
+
+    settings->setValue(Settings::RightToLeft, !old);
+    QCOMPARE(settings->snapshot().rightToLeft, !old);
+
+    // Pending values are written by sync()
+    settings->sync();
+    QSettings file(settings->fileName(), QSettings::IniFormat);
+    QCOMPARE(file.value("Project/RightToLeft").toBool(), !old);
+
+    settings->setValue(Settings::RightToLeft, old);
+    QCOMPARE(settings->snapshot().rightToLeft, old);
+
+    // The values of the array items are cached by the full key,
+    // so the items don't mix up.
+    settings->beginGroup("Printer_TestSettingsSnapshot");
+    settings->beginWriteArray("Profiles");
+    for (int i=0; i<2; ++i)
+    {
+        settings->setArrayIndex(i);
+        settings->setValue(Settings::PrinterProfile_Name, QString("Profile %1").arg(i));
+    }
+    settings->endArray();
+
+    QCOMPARE(settings->beginReadArray("Profiles"), 2);
+    for (int i=0; i<2; ++i)
+    {
+        settings->setArrayIndex(i);
+        QCOMPARE(settings->value(Settings::PrinterProfile_Name).toString(), QString("Profile %1").arg(i));
+    }
+    settings->endArray();
+    settings->endGroup();
+
+    settings->sync();
+    file.sync();
+    QCOMPARE(file.value("Printer_TestSettingsSnapshot/Profiles/2/Name").toString(), QString("Profile 1"));
+}
+
 /************************************************
  *
  * ***********************************************/
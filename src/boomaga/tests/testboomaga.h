@@ -63,6 +63,19 @@ private slots:
     void test_BooklesSplit();
     void test_BooklesSplit_data();
 
+    void testSettingsSnapshot();
+
+    void testPrefetchPolicy();
+    void testPrefetchPolicy_HitRate();
+    void testPrefetchPolicy_HitRate_data();
+
+    void testPageIndex();
+    void benchmarkPageIndex_Lookup();
+    void benchmarkPageIndex_Lookup_data();
+
+    void testProjectHistory();
+    void testProjectHistory_Depth();
+
     void testPdfArray();
 
     void testPdfBool();
@@ -81,6 +94,13 @@ private slots:
     void testInFiles();
     void testInFiles_data();
 
+    void testBooFileBlobs();
+
+    void testMergedHandOff();
+
+    void testDscPageCount();
+    void testDscPageCount_data();
+
     // PDF::Value .........................................
 
 
@@ -102,6 +122,17 @@ private slots:
     void testPdfReader_ReadStringLiteral();
     void testPdfReader_ReadStringLiteral_data();
 
+    void testPdfReader_StringRoundTrip();
+    void testPdfReader_StringRoundTrip_data();
+
+    void testPdfReader_ReadStream();
+    void testPdfReader_ReadStream_data();
+
+    void testPdfScan();
+
+    void benchmarkPdfReader_Load();
+    void benchmarkPdfReader_Load_data();
+
     // PDF::Reader ........................................
 
     // PDF::Writer ........................................
@@ -0,0 +1,142 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#include "testboomaga.h"
+
+#include <QTest>
+#include "../kernel/sheet.h"
+#include "../kernel/job.h"
+#include "../kernel/projectpage.h"
+
+#define PAGES_PER_SHEET 2
+
+namespace {
+
+/************************************************
+ *
+ ************************************************/
+QList<ProjectPage*> fillSheets(SheetList *sheets, int sheetCount)
+{
+    QList<ProjectPage*> pages;
+    for (int s=0; s<sheetCount; ++s)
+    {
+        Sheet *sheet = new Sheet(PAGES_PER_SHEET, s);
+        for (int p=0; p<PAGES_PER_SHEET; ++p)
+        {
+            ProjectPage *page = new ProjectPage();
+            sheet->setPage(p, page);
+            pages << page;
+        }
+        *sheets << sheet;
+    }
+
+    sheets->updateIndex();
+    return pages;
+}
+
+
+} // namespace
+
+
+/************************************************
+ *
+ ************************************************/
+void TestBoomaga::testPageIndex()
+{
+    SheetList sheets;
+    QList<ProjectPage*> pages = fillSheets(&sheets, 100);
+
+    for (int i=0; i<pages.count(); ++i)
+        QCOMPARE(sheets.indexOfPage(pages.at(i)), i / PAGES_PER_SHEET);
+
+    QCOMPARE(sheets.indexOfPage(pages.at(10), 6), -1);
+    QCOMPARE(sheets.indexOfPage((ProjectPage*)0), -1);
+
+    // The list is changed after updateIndex: the stale index must not be used.
+    Sheet *first = sheets.takeFirst();
+    QCOMPARE(sheets.indexOfPage(pages.at(0)), -1);
+    QCOMPARE(sheets.indexOfPage(pages.at(2)), 0);
+    sheets.prepend(first);
+
+    JobList jobs;
+    for (int j=0; j<10; ++j)
+    {
+        Job job;
+        for (int p=0; p<10; ++p)
+            job.addPage(pages.at(j * 10 + p));
+        jobs << job;
+    }
+    jobs.updateIndex();
+
+    for (int i=0; i<pages.count(); ++i)
+        QCOMPARE(jobs.indexOfProjectPage(pages.at(i)), i / 10);
+
+    QCOMPARE(jobs.indexOfProjectPage(pages.at(15), 2), -1);
+
+    // The page is moved to another job after updateIndex.
+    jobs[1].takePage(pages.at(15));
+    jobs[7].addPage(pages.at(15));
+    QCOMPARE(jobs.indexOfProjectPage(pages.at(15)), 7);
+
+    // The pages are deleted by the jobs.
+    qDeleteAll(sheets);
+}
+
+
+/************************************************
+ * The last pages are the worst case for the linear
+ * search, with the index the cost doesn't depend on
+ * the sheet count.
+ ************************************************/
+void TestBoomaga::benchmarkPageIndex_Lookup()
+{
+    QFETCH(int, sheetCount);
+
+    SheetList sheets;
+    QList<ProjectPage*> pages = fillSheets(&sheets, sheetCount);
+
+    int n = 0;
+    QBENCHMARK
+    {
+        int i = pages.count() - 1 - (n++ % 64);
+        QCOMPARE(sheets.indexOfPage(pages.at(i)), i / PAGES_PER_SHEET);
+    }
+
+    qDeleteAll(sheets);
+    qDeleteAll(pages);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void TestBoomaga::benchmarkPageIndex_Lookup_data()
+{
+    QTest::addColumn<int>("sheetCount");
+
+    QTest::newRow("100 sheets")   << 100;
+    QTest::newRow("50000 sheets") << 50000;
+}
@@ -27,7 +27,11 @@
 #include "testboomaga.h"
 
 #include <QTest>
+#include <QBuffer>
 #include "../pdfparser/pdfreader.h"
+#include "../pdfparser/pdfobject.h"
+#include "../pdfparser/pdfwriter.h"
+#include "../pdfparser/pdfscan.h"
 #include "tools.h"
 
 
@@ -109,6 +113,10 @@ void TestBoomaga::testPdfReader_ReadName_data()
 
     QTest::newRow("01") << "/Name "     << 0 << "Name"  << 5;
     QTest::newRow("02") << "/Name/Val"  << 0 << "Name"  << 5;
+    QTest::newRow("03") << "/A#20B "    << 0 << "A B"   << 7;
+    QTest::newRow("04") << "/A#23 "     << 0 << "A#"    << 5;
+    QTest::newRow("05") << "/A#2 "      << 0 << "A#2"   << 4;
+    QTest::newRow("06") << "/ "         << 0 << ""      << 1;
 }
 
 
@@ -473,3 +481,262 @@ void TestBoomaga::testPdfReader_ReadStringLiteral_data()
             << "(These \\(two (\\(strings are) \\(the \\)same.)Not string"
             << "These (two ((strings are) (the )same.";
 }
+
+
+/************************************************
+ *
+ ************************************************/
+void TestBoomaga::testPdfReader_ReadStream()
+{
+    QFETCH(QString, data);
+    QFETCH(QString, expected);
+
+    TestReader reader(data);
+    try
+    {
+        PDF::Object obj;
+        qint64 end = reader.readObject(0, &obj);
+
+        QCOMPARE(QString::fromLatin1(obj.stream()), expected);
+        QCOMPARE(end, qint64(data.indexOf("endobj") + 6));
+    }
+    catch (PDF::Error& e)
+    {
+        FAIL_EXCEPTION(e);
+    }
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void TestBoomaga::testPdfReader_ReadStream_data()
+{
+    QTest::addColumn<QString>("data");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("Correct length")
+            << "1 0 obj <</Length 5>> stream\nHello\nendstream endobj"      << "Hello";
+
+    QTest::newRow("Correct length, CRLF")
+            << "1 0 obj <</Length 5>> stream\r\nHello\r\nendstream endobj"  << "Hello";
+
+    QTest::newRow("Short length")
+            << "1 0 obj <</Length 3>> stream\nHello\nendstream endobj"      << "Hello";
+
+    QTest::newRow("Long length")
+            << "1 0 obj <</Length 500>> stream\nHello\nendstream endobj"    << "Hello";
+
+    QTest::newRow("No length")
+            << "1 0 obj <</Filter /None>> stream\nHello\nendstream endobj"  << "Hello";
+
+    QTest::newRow("Missing length object")
+            << "1 0 obj <</Length 9 0 R>> stream\r\nHello\r\nendstream endobj" << "Hello";
+}
+
+
+/************************************************
+ * The strings are written byte to byte as they were read,
+ * the binary data must not be changed by text decoding.
+ ************************************************/
+void TestBoomaga::testPdfReader_StringRoundTrip()
+{
+    QFETCH(QString,    data);
+    QFETCH(QByteArray, expected);
+
+    TestReader reader(data);
+    PDF::Value v;
+    quint64 pos = 0;
+    try
+    {
+        v = reader.readValue(&pos);
+    }
+    catch (PDF::Error& e)
+    {
+        FAIL_EXCEPTION(e);
+    }
+
+    QBuffer buf;
+    buf.open(QIODevice::ReadWrite);
+    PDF::Writer writer(&buf);
+    writer.writeValue(v);
+    QCOMPARE(buf.buffer(), expected);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void TestBoomaga::testPdfReader_StringRoundTrip_data()
+{
+    QTest::addColumn<QString>("data");
+    QTest::addColumn<QByteArray>("expected");
+
+    QTest::newRow("Hex binary")
+            << "<00FF80C3>"
+            << QByteArray("<00ff80c3>");
+
+    QTest::newRow("Hex UTF-16")
+            << "<FEFF0054>"
+            << QByteArray("<feff0054>");
+
+    QTest::newRow("Literal binary")
+            << "(\\000\\377\\200)"
+            << QByteArray("(\\000\\377\\200)");
+
+    QTest::newRow("Literal Latin-1")
+            << "(Caf\\351)"
+            << QByteArray("(Caf\\351)");
+}
+
+
+/************************************************
+ * Compares the PDF::Scan functions with the naive
+ * implementation on the random data. The lengths are
+ * chosen to cover the SIMD blocks and the scalar tails.
+ ************************************************/
+void TestBoomaga::testPdfScan()
+{
+    qsrand(1);
+    const char alphabet[] = "ab \n\r(%/x";
+    const int alphabetLen = sizeof(alphabet) - 1;
+
+    for (int n=0; n<20000; ++n)
+    {
+        QByteArray data(qrand() % 120, ' ');
+        for (int i=0; i<data.size(); ++i)
+            data[i] = alphabet[qrand() % alphabetLen];
+
+        QByteArray str(1 + qrand() % 4, ' ');
+        for (int i=0; i<str.size(); ++i)
+            str[i] = alphabet[qrand() % 3];
+
+        const char *begin = data.constData();
+        const char *end   = begin + data.size();
+        auto offset = [begin](const char *p) { return p ? qint64(p - begin) : qint64(-1); };
+
+        QCOMPARE(offset(PDF::Scan::find(begin, end, str.constData(), str.size())),
+                 qint64(data.indexOf(str)));
+
+        QCOMPARE(offset(PDF::Scan::findBack(begin, end, str.constData(), str.size())),
+                 qint64(data.lastIndexOf(str)));
+
+        const char *from = begin + qrand() % (data.size() + 1);
+
+        const char *p = from;
+        while (p < end && isspace(*p))
+            ++p;
+        QCOMPARE(offset(PDF::Scan::skipSpace(from, end)), offset(p));
+
+        p = from;
+        while (p < end && !isspace(*p) && !strchr("()<>[]{}/%", *p))
+            ++p;
+        QCOMPARE(offset(PDF::Scan::findDelim(from, end)), offset(p));
+
+        p = from;
+        while (p < end && *p != '\n' && *p != '\r')
+            ++p;
+        QCOMPARE(offset(PDF::Scan::findEol(from, end)), offset(p));
+    }
+}
+
+
+/************************************************
+ * Generates the uncompressed PDF document, where
+ * the tokenizing takes the most of the loading time.
+ ************************************************/
+static QByteArray createUncompressedPdf(int pageCount)
+{
+    QByteArray res;
+    QVector<int> offsets;
+
+    res.append("%PDF-1.4\n");
+
+    QByteArray kids;
+    for (int i=0; i<pageCount; ++i)
+        kids.append(QString("%1 0 R ").arg(3 + i * 2).toLatin1());
+
+    offsets << res.size();
+    res.append("1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+
+    offsets << res.size();
+    res.append(QString("2 0 obj\n<< /Type /Pages /Count %1 /Kids [ %2] >>\nendobj\n")
+               .arg(pageCount).arg(QString(kids)).toLatin1());
+
+    QByteArray widths;
+    for (int i=0; i<224; ++i)
+        widths.append(QString(" %1").arg(250 + (i * 37) % 750).toLatin1());
+
+    QByteArray content;
+    for (int i=0; i<50; ++i)
+        content.append(QString("BT /F1 12 Tf %1 %2 Td (Line %3 of the page) Tj ET\n")
+                       .arg(72).arg(720 - i * 13.5, 0, 'f', 2).arg(i).toLatin1());
+
+    for (int i=0; i<pageCount; ++i)
+    {
+        int pageNum = 3 + i * 2;
+        offsets << res.size();
+        res.append(QString("%1 0 obj\n"
+                           "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 595.276 841.89] "
+                           "/Resources << /Font << /F1 << /Type /Font /Subtype /Type1 /BaseFont /Helvetica "
+                           "/FirstChar 32 /LastChar 255 /Widths [%2 ] >> >> >> "
+                           "/Contents %3 0 R >>\n"
+                           "endobj\n")
+                   .arg(pageNum).arg(QString(widths)).arg(pageNum + 1).toLatin1());
+
+        offsets << res.size();
+        res.append(QString("%1 0 obj\n<< /Length %2 >>\nstream\n")
+                   .arg(pageNum + 1).arg(content.size()).toLatin1());
+        res.append(content);
+        res.append("\nendstream\nendobj\n");
+    }
+
+    int xrefPos = res.size();
+    res.append(QString("xref\n0 %1\n").arg(offsets.count() + 1).toLatin1());
+    res.append("0000000000 65535 f \n");
+    foreach (int offset, offsets)
+        res.append(QString("%1 00000 n \n").arg(offset, 10, 10, QChar('0')).toLatin1());
+
+    res.append(QString("trailer\n<< /Root 1 0 R /Size %1 >>\n").arg(offsets.count() + 1).toLatin1());
+    res.append(QString("startxref\n%1\n%%EOF\n").arg(xrefPos).toLatin1());
+    return res;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void TestBoomaga::benchmarkPdfReader_Load()
+{
+    QFETCH(int, pageCount);
+    QByteArray data = createUncompressedPdf(pageCount);
+
+    try
+    {
+        QBENCHMARK
+        {
+            PDF::Reader reader;
+            reader.open(data.constData(), data.size());
+            QCOMPARE(reader.pageCount(), quint32(pageCount));
+
+            for (int i=0; i<pageCount * 2; ++i)
+                reader.getObject(3 + i, 0);
+        }
+    }
+    catch (PDF::Error& e)
+    {
+        FAIL_EXCEPTION(e);
+    }
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void TestBoomaga::benchmarkPdfReader_Load_data()
+{
+    QTest::addColumn<int>("pageCount");
+
+    QTest::newRow("100 pages")   << 100;
+    QTest::newRow("1000 pages")  << 1000;
+}
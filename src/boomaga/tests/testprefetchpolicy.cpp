@@ -0,0 +1,342 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#include "testboomaga.h"
+
+#include <QTest>
+#include <QVector>
+#include "../prefetchpolicy.h"
+
+#define SHEET_COUNT 300
+#define BUDGET      31
+
+namespace {
+
+struct Visit
+{
+    int sheet;
+    qint64 time;
+};
+
+typedef QVector<Visit> Trace;
+
+
+/************************************************
+ * Simulates the Render: workers with the fixed render
+ * time and the queue of requests.
+ ************************************************/
+class RenderSim
+{
+public:
+    RenderSim(int workers, int renderTime):
+        mWorkers(workers),
+        mRenderTime(renderTime)
+    {
+    }
+
+    // Returns the sheets finished until time t.
+    QVector<int> advance(qint64 t)
+    {
+        QVector<int> res;
+        while (!mInFlight.isEmpty())
+        {
+            int n = 0;
+            for (int i=1; i<mInFlight.count(); ++i)
+            {
+                if (mInFlight.at(i).time < mInFlight.at(n).time)
+                    n = i;
+            }
+
+            Visit job = mInFlight.at(n);
+            if (job.time > t)
+                break;
+
+            mInFlight.removeAt(n);
+            res << job.sheet;
+
+            if (!mQueue.isEmpty())
+                mInFlight << Visit{mQueue.takeFirst(), job.time + mRenderTime};
+        }
+        return res;
+    }
+
+    // Like Render::renderSheet (urgent) and Render::prefetchSheet.
+    void request(int sheet, qint64 t, bool urgent)
+    {
+        if (mInFlight.count() < mWorkers)
+        {
+            mInFlight << Visit{sheet, t + mRenderTime};
+            return;
+        }
+
+        if (mQueue.contains(sheet))
+            return;
+
+        if (urgent)
+            mQueue.prepend(sheet);
+        else
+            mQueue << sheet;
+    }
+
+    bool cancel(int sheet)
+    {
+        return mQueue.removeAll(sheet) > 0;
+    }
+
+private:
+    int mWorkers;
+    int mRenderTime;
+    QVector<int> mQueue;
+    QVector<Visit> mInFlight;
+};
+
+
+/************************************************
+ * The same steps as RenderCache::renderSheet
+ ************************************************/
+double simulateAdaptive(const Trace &trace, int workers, int renderTime)
+{
+    RenderSim render(workers, renderTime);
+    PrefetchPolicy policy;
+    policy.setBudget(BUDGET);
+    policy.setWorkerCount(workers);
+    policy.setRenderTime(renderTime);
+
+    QVector<int> cache;
+    QVector<int> pending;
+    PrefetchPolicy::Window window = {0, SHEET_COUNT - 1};
+    int hits = 0;
+
+    for (const Visit &visit: trace)
+    {
+        for (int sheet: render.advance(visit.time))
+        {
+            pending.removeAll(sheet);
+            if (window.contains(sheet))
+                cache << sheet;
+        }
+
+        if (cache.contains(visit.sheet))
+            ++hits;
+
+        policy.visit(visit.sheet, visit.time);
+        window = policy.window(visit.sheet, SHEET_COUNT);
+
+        for (int i=cache.count()-1; i>=0; --i)
+        {
+            if (!window.contains(cache.at(i)))
+                cache.removeAt(i);
+        }
+
+        for (int i=pending.count()-1; i>=0; --i)
+        {
+            if (render.cancel(pending.at(i)))
+                pending.removeAt(i);
+        }
+
+        for (int sheet: policy.plan(visit.sheet, SHEET_COUNT))
+        {
+            if (cache.contains(sheet) || pending.contains(sheet))
+                continue;
+
+            pending << sheet;
+            render.request(sheet, visit.time, sheet == visit.sheet);
+        }
+    }
+
+    return hits * 1.0 / trace.count();
+}
+
+
+/************************************************
+ * The fixed window, 10 sheets back and 20 ahead,
+ * all requests are placed at the head of the queue.
+ ************************************************/
+double simulateFixed(const Trace &trace, int workers, int renderTime)
+{
+    RenderSim render(workers, renderTime);
+    QVector<int> cache;
+    int hits = 0;
+
+    for (const Visit &visit: trace)
+    {
+        for (int sheet: render.advance(visit.time))
+        {
+            if (!cache.contains(sheet))
+                cache << sheet;
+        }
+
+        if (cache.contains(visit.sheet))
+            ++hits;
+
+        int start = qMax(0, visit.sheet - 10);
+        int end   = qMin(SHEET_COUNT - 1, visit.sheet + 20);
+
+        for (int i=start; i<=end; ++i)
+        {
+            if (!cache.contains(i))
+                render.request(i, visit.time, true);
+        }
+
+        for (int i=cache.count()-1; i>=0; --i)
+        {
+            if (cache.at(i) < start || cache.at(i) > end)
+                cache.removeAt(i);
+        }
+    }
+
+    return hits * 1.0 / trace.count();
+}
+
+
+/************************************************
+ *
+ ************************************************/
+Trace pagingTrace(int first, int step, int count, int interval)
+{
+    Trace res;
+    for (int i=0; i<count; ++i)
+        res << Visit{first + i * step, qint64(i) * interval};
+
+    return res;
+}
+
+
+/************************************************
+ * Quickly skims a few sheets, then reads some of them.
+ ************************************************/
+Trace readingTrace()
+{
+    Trace res;
+    int sheet = 0;
+    qint64 time = 0;
+    for (int burst=0; burst<6; ++burst)
+    {
+        for (int i=0; i<15; ++i)
+        {
+            res << Visit{sheet++, time};
+            time += 80;
+        }
+
+        for (int i=0; i<5; ++i)
+        {
+            res << Visit{sheet++, time};
+            time += 2000;
+        }
+    }
+
+    return res;
+}
+
+
+/************************************************
+ * Pages faster than the render, then stops and
+ * looks at the last sheet. The hits are only
+ * possible after the stop, the sheet is checked
+ * every 100 msec.
+ ************************************************/
+Trace burstStopTrace()
+{
+    Trace res = pagingTrace(0, 1, 30, 20);
+    Visit last = res.last();
+    for (int i=1; i<=20; ++i)
+        res << Visit{last.sheet, last.time + i * 100};
+
+    return res;
+}
+
+} // namespace
+
+Q_DECLARE_METATYPE(Trace)
+
+
+/************************************************
+ *
+ ************************************************/
+void TestBoomaga::testPrefetchPolicy()
+{
+    PrefetchPolicy policy;
+    policy.setBudget(BUDGET);
+
+    // No movement, the window is the same as before
+    policy.visit(50, 0);
+    QCOMPARE(policy.direction(), 0);
+    QCOMPARE(policy.window(50, SHEET_COUNT).first, 40);
+    QCOMPARE(policy.window(50, SHEET_COUNT).last,  70);
+    QCOMPARE(policy.plan(50, SHEET_COUNT).first(), 50);
+
+    // Fast paging back
+    for (int i=1; i<10; ++i)
+        policy.visit(50 - i, i * 50);
+
+    QCOMPARE(policy.direction(), -1);
+    PrefetchPolicy::Window win = policy.window(41, SHEET_COUNT);
+    QVERIFY(41 - win.first > win.last - 41);
+    QCOMPARE(win.last - win.first + 1, BUDGET);
+
+    // Long pause resets the speed
+    policy.visit(41, 10000);
+    QCOMPARE(policy.direction(), 0);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void TestBoomaga::testPrefetchPolicy_HitRate_data()
+{
+    QTest::addColumn<Trace>("trace");
+    QTest::addColumn<int>("workers");
+    QTest::addColumn<int>("renderTime");
+    QTest::addColumn<double>("minHitRate");
+
+    QTest::newRow("forward 4x200")  << pagingTrace(0, 1, 100, 70)                << 4 << 200 << 0.9;
+    QTest::newRow("forward 8x150")  << pagingTrace(0, 1, 100, 70)                << 8 << 150 << 0.9;
+    QTest::newRow("backward 4x200") << pagingTrace(SHEET_COUNT - 1, -1, 100, 80) << 4 << 200 << 0.9;
+    QTest::newRow("reading 4x200")  << readingTrace()                            << 4 << 200 << 0.9;
+    QTest::newRow("reading 8x400")  << readingTrace()                            << 8 << 400 << 0.9;
+    QTest::newRow("burst stop 4x400") << burstStopTrace()                        << 4 << 400 << 0.25;
+    QTest::newRow("burst stop 2x400") << burstStopTrace()                        << 2 << 400 << 0.25;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void TestBoomaga::testPrefetchPolicy_HitRate()
+{
+    QFETCH(Trace, trace);
+    QFETCH(int, workers);
+    QFETCH(int, renderTime);
+    QFETCH(double, minHitRate);
+
+    double adaptive = simulateAdaptive(trace, workers, renderTime);
+    double fixed    = simulateFixed(trace, workers, renderTime);
+
+    qDebug() << "Hit rate: adaptive" << adaptive << "fixed window" << fixed;
+    QVERIFY2(adaptive >= minHitRate, qPrintable(QString("Hit rate %1").arg(adaptive)));
+    QVERIFY(adaptive >= fixed);
+}
@@ -0,0 +1,142 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ *
+ * Copyright: 2018 Boomaga team https://github.com/Boomaga
+ * Authors:
+ *   Alexander Sokoloff <sokoloff.a@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+
+#include "testboomaga.h"
+
+#include <QTest>
+#include "../kernel/projecthistory.h"
+#include "../kernel/projectpage.h"
+
+
+/************************************************
+ *
+ ************************************************/
+static Job createJob(int pageCount)
+{
+    Job job;
+    for (int i=0; i<pageCount; ++i)
+        job.addPage(new ProjectPage(i));
+
+    return job;
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void TestBoomaga::testProjectHistory()
+{
+    JobList jobs;
+    jobs << createJob(3) << createJob(2);
+    Job job0 = jobs.at(0);
+    Job job1 = jobs.at(1);
+
+    ProjectHistory history;
+    history.reset(jobs);
+    QVERIFY(!history.canUndo());
+    QVERIFY(!history.canRedo());
+
+    // Hide and rotate the page ...................
+    ProjectPage *page = job0.page(1);
+    page->hide();
+    page->setManualRotation(Rotate90);
+    history.commit(jobs, QList<Job>() << job0);
+
+    // Insert the blank page ......................
+    ProjectPage *blank = job1.insertBlankPage(0);
+    history.commit(jobs, QList<Job>() << job1);
+
+    // Move the job ...............................
+    jobs.move(1, 0);
+    history.commit(jobs, QList<Job>());
+    QVERIFY(history.canUndo());
+    QVERIFY(!history.canRedo());
+
+    history.undo(&jobs);
+    QVERIFY(jobs.at(0) == job0);
+    QCOMPARE(job1.pageCount(), 3);
+
+    history.undo(&jobs);
+    QCOMPARE(job1.pageCount(), 2);
+    QCOMPARE(job1.indexOfPage(blank), -1);
+
+    history.undo(&jobs);
+    QVERIFY(!history.canUndo());
+    QCOMPARE(page->visible(), true);
+    QCOMPARE(page->manualRotation(), NoRotate);
+
+    history.redo(&jobs);
+    QCOMPARE(page->visible(), false);
+    QCOMPARE(page->manualRotation(), Rotate90);
+
+    history.redo(&jobs);
+    QCOMPARE(job1.page(0), blank);
+
+    history.redo(&jobs);
+    QVERIFY(jobs.at(0) == job1);
+    QVERIFY(!history.canRedo());
+
+    // The new edit after undo drops the redo versions
+    history.undo(&jobs);
+    history.undo(&jobs);
+    page->show();
+    history.commit(jobs, QList<Job>() << job0);
+    QVERIFY(!history.canRedo());
+    QCOMPARE(job1.pageCount(), 2);
+
+    history.undo(&jobs);
+    QCOMPARE(page->visible(), false);
+}
+
+
+/************************************************
+ *
+ ************************************************/
+void TestBoomaga::testProjectHistory_Depth()
+{
+    JobList jobs;
+    jobs << createJob(4);
+    Job job = jobs.at(0);
+
+    ProjectHistory history(5);
+    history.reset(jobs);
+
+    for (int i=0; i<10; ++i)
+    {
+        job.insertBlankPage(0);
+        history.commit(jobs, QList<Job>() << job);
+    }
+
+    int undone = 0;
+    while (history.canUndo())
+    {
+        history.undo(&jobs);
+        ++undone;
+    }
+
+    QCOMPARE(undone, 4);
+    QCOMPARE(job.pageCount(), 4 + 6);
+}